@@ -0,0 +1,91 @@
+#include "adpcm.h"
+
+static const int16_t stepTable[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794,
+    32767
+};
+
+static const int8_t indexTable[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8,
+    -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static inline int clampInt(int v, int lo, int hi) {
+    return v < lo ? lo : v > hi ? hi : v;
+}
+
+// applies one nibble, returns the new sample
+static inline int step(AdpcmState *s, int nibble) {
+    int st = stepTable[s->index];
+    int diff = st >> 3;
+    if(nibble & 1) diff += st >> 2;
+    if(nibble & 2) diff += st >> 1;
+    if(nibble & 4) diff += st;
+    if(nibble & 8) diff = -diff;
+
+    s->predictor = clampInt(s->predictor + diff, -32768, 32767);
+    s->index = clampInt(s->index + indexTable[nibble], 0, 88);
+    return s->predictor;
+}
+
+static int encodeSample(AdpcmState *s, int sample) {
+    int st = stepTable[s->index];
+    int diff = sample - s->predictor;
+    int nibble = 0;
+    if(diff < 0) {
+        nibble = 8;
+        diff = -diff;
+    }
+    if(diff >= st) { nibble |= 4; diff -= st; }
+    st >>= 1;
+    if(diff >= st) { nibble |= 2; diff -= st; }
+    st >>= 1;
+    if(diff >= st) nibble |= 1;
+
+    // track what the decoder will reconstruct, not the input
+    step(s, nibble);
+    return nibble;
+}
+
+void adpcmEncodeBlock(uint8_t *block, const int16_t *pcm, int frames, AdpcmState state[ADPCM_CHANNELS]) {
+    for(int c = 0; c < ADPCM_CHANNELS; ++c) {
+        uint8_t *header = block + c*ADPCM_CHANNEL_BYTES;
+        uint8_t *data = header + 4;
+        AdpcmState *s = &state[c];
+
+        header[0] = (uint16_t)s->predictor;
+        header[1] = (uint16_t)s->predictor >> 8;
+        header[2] = (uint8_t)s->index;
+        header[3] = 0;
+
+        for(int i = 0; i < ADPCM_BLOCK_FRAMES; i += 2) {
+            int a = i < frames ? i : frames - 1;
+            int b = i + 1 < frames ? i + 1 : frames - 1;
+            int lo = encodeSample(s, pcm[a*ADPCM_CHANNELS + c]);
+            int hi = encodeSample(s, pcm[b*ADPCM_CHANNELS + c]);
+            data[i/2] = (uint8_t)(lo | hi << 4);
+        }
+    }
+}
+
+void adpcmDecodeBlock(int16_t *pcm, const uint8_t *block) {
+    const uint8_t *lh = block, *rh = block + ADPCM_CHANNEL_BYTES;
+    const uint8_t *left = lh + 4, *right = rh + 4;
+    AdpcmState l = {(int16_t)(lh[0] | lh[1] << 8), clampInt(lh[2], 0, 88)};
+    AdpcmState r = {(int16_t)(rh[0] | rh[1] << 8), clampInt(rh[2], 0, 88)};
+
+    // each channel is one long dependency chain, running both in the same
+    // loop lets the CPU overlap them
+    for(int i = 0; i < ADPCM_BLOCK_FRAMES/2; ++i) {
+        int lb = left[i], rb = right[i];
+        pcm[4*i + 0] = (int16_t)step(&l, lb & 15);
+        pcm[4*i + 1] = (int16_t)step(&r, rb & 15);
+        pcm[4*i + 2] = (int16_t)step(&l, lb >> 4);
+        pcm[4*i + 3] = (int16_t)step(&r, rb >> 4);
+    }
+}
@@ -0,0 +1,38 @@
+#ifndef ADPCM_H
+#define ADPCM_H
+
+#include <stdint.h>
+
+// IMA-ADPCM, 4 bits per sample, stereo. Audio is cut into blocks of
+// ADPCM_BLOCK_FRAMES frames that each start with the decoder state of
+// both channels, so any block decodes on its own (cheap seeking, and the
+// mixer only decodes the block a voice is in). Per block and channel:
+//
+//   int16 predictor, uint8 step index, uint8 reserved,
+//   ADPCM_BLOCK_FRAMES/2 bytes of nibbles, low nibble first
+//
+// 16-bit PCM shrinks to a bit under a quarter of its size.
+
+#define ADPCM_BLOCK_FRAMES 512
+#define ADPCM_CHANNELS 2
+#define ADPCM_CHANNEL_BYTES (4 + ADPCM_BLOCK_FRAMES/2)
+#define ADPCM_BLOCK_BYTES (ADPCM_CHANNELS*ADPCM_CHANNEL_BYTES)
+
+typedef struct AdpcmState {
+    int predictor;
+    int index;
+} AdpcmState;
+
+// Encodes up to ADPCM_BLOCK_FRAMES interleaved frames, a short last block
+// is padded with its final frame. state carries over between blocks.
+void adpcmEncodeBlock(uint8_t *block, const int16_t *pcm, int frames, AdpcmState state[ADPCM_CHANNELS]);
+
+// Decodes one block into ADPCM_BLOCK_FRAMES interleaved frames
+void adpcmDecodeBlock(int16_t *pcm, const uint8_t *block);
+
+// Blocks needed for frames
+static inline uint32_t adpcmBlockCount(uint32_t frames) {
+    return (frames + ADPCM_BLOCK_FRAMES - 1)/ADPCM_BLOCK_FRAMES;
+}
+
+#endif
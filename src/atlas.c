@@ -0,0 +1,125 @@
+#include "atlas.h"
+
+#include <stdio.h>
+#include <string.h>
+
+Sprite spriteFromTexture(Texture2D texture) {
+    return (Sprite){texture, (Rectangle){0, 0, texture.width, texture.height}, (Vector2){0, 0}, (Vector2){texture.width, texture.height}};
+}
+
+Rectangle spriteTrimmedDest(Sprite sprite, Rectangle dest) {
+    if(sprite.size.x <= 0 || sprite.size.y <= 0) return dest;
+    float sx = dest.width/sprite.size.x, sy = dest.height/sprite.size.y;
+    return (Rectangle){
+        dest.x + sprite.offset.x*sx,
+        dest.y + sprite.offset.y*sy,
+        sprite.source.width*sx,
+        sprite.source.height*sy
+    };
+}
+
+void spriteDraw(Sprite sprite, Rectangle dest, Color tint) {
+    if(sprite.texture.id == 0) return;
+    DrawTexturePro(sprite.texture, sprite.source, spriteTrimmedDest(sprite, dest), (Vector2){0, 0}, 0.0f, tint);
+}
+
+static int findName(const Atlas *atlas, const char *name) {
+    for(int i = 0; i < atlas->count; ++i) {
+        if(strcmp(atlas->names[i], name) == 0) return i;
+    }
+    return -1;
+}
+
+static void addSprite(Atlas *atlas, const char *name, Sprite sprite) {
+    snprintf(atlas->names[atlas->count], sizeof(atlas->names[0]), "%s", name);
+    atlas->sprites[atlas->count++] = sprite;
+}
+
+// Reads dir/atlas.txt, keeps only the requested names
+// texture is the atlas png if it's already loaded, this takes it over
+static void loadManifest(Atlas *atlas, const Pak *pak, const char *dir, const char *const *names, int count, Texture2D texture) {
+    char *text = pakLoadText(pak, TextFormat("%s/atlas.txt", dir));
+    if(text == NULL) {
+        if(texture.id) UnloadTexture(texture);
+        return;
+    }
+
+    char image[200];
+    int width, height;
+    if(sscanf(text, "# %199s %d %d", image, &width, &height) != 3) {
+        TraceLog(LOG_WARNING, "ATLAS: %s/atlas.txt has no header", dir);
+        if(texture.id) UnloadTexture(texture);
+        MemFree(text);
+        return;
+    }
+
+    // the tool writes the path it was given, the png sits next to the manifest
+    if(texture.id == 0) texture = pakLoadTexture(pak, TextFormat("%s/%s", dir, GetFileName(image)));
+    if(texture.id == 0) {
+        MemFree(text);
+        return;
+    }
+    if(texture.width != width || texture.height != height) {
+        TraceLog(LOG_WARNING, "ATLAS: %s doesn't match its manifest, rebuild it", image);
+        UnloadTexture(texture);
+        MemFree(text);
+        return;
+    }
+    atlas->textures[atlas->textureCount++] = texture;
+
+    char name[64];
+    float x, y, w, h, ox, oy, fw, fh;
+    for(char *line = strchr(text, '\n'); line; line = strchr(line, '\n')) {
+        ++line;
+        // older manifests have no trim fields
+        int fields = sscanf(line, "%63s %f %f %f %f %f %f %f %f", name, &x, &y, &w, &h, &ox, &oy, &fw, &fh);
+        if(fields == 5) {
+            ox = oy = 0;
+            fw = w;
+            fh = h;
+        } else if(fields != 9) {
+            continue;
+        }
+        for(int i = 0; i < count; ++i) {
+            if(strcmp(names[i], name) == 0 && findName(atlas, name) < 0 && atlas->count < ATLAS_MAX_SPRITES) {
+                addSprite(atlas, name, (Sprite){texture, (Rectangle){x, y, w, h}, (Vector2){ox, oy}, (Vector2){fw, fh}});
+            }
+        }
+    }
+    MemFree(text);
+}
+
+bool atlasLoad(Atlas *atlas, const Pak *pak, const char *dir, const char *const *names, int count) {
+    return atlasLoadWith(atlas, pak, dir, names, count, (Texture2D){0});
+}
+
+bool atlasLoadWith(Atlas *atlas, const Pak *pak, const char *dir, const char *const *names, int count, Texture2D texture) {
+    memset(atlas, 0, sizeof(*atlas));
+    if(count > ATLAS_MAX_SPRITES) count = ATLAS_MAX_SPRITES;
+
+    loadManifest(atlas, pak, dir, names, count, texture);
+
+    bool ok = true;
+    for(int i = 0; i < count; ++i) {
+        if(findName(atlas, names[i]) >= 0) continue;
+
+        Texture2D texture = pakLoadTexture(pak, TextFormat("%s/%s.png", dir, names[i]));
+        if(texture.id == 0) {
+            ok = false;
+            continue;
+        }
+        atlas->textures[atlas->textureCount++] = texture;
+        addSprite(atlas, names[i], spriteFromTexture(texture));
+    }
+    return ok;
+}
+
+void atlasUnload(Atlas *atlas) {
+    for(int i = 0; i < atlas->textureCount; ++i) UnloadTexture(atlas->textures[i]);
+    memset(atlas, 0, sizeof(*atlas));
+}
+
+Sprite atlasSprite(const Atlas *atlas, const char *name) {
+    int i = findName(atlas, name);
+    return i >= 0 ? atlas->sprites[i] : (Sprite){0};
+}
@@ -0,0 +1,64 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <raylib.h>
+#include <stdbool.h>
+
+#include "pak.h"
+
+// Sprites packed into one texture by atlasPack at build time. The manifest
+// (atlas.txt next to the sprites) maps each sprite name to its rectangle,
+// and for sprites trimmed of their transparent border, to where that
+// rectangle sits in the untrimmed frame.
+// Names the manifest doesn't know, or a missing manifest, fall back to
+// loading <dir>/<name>.png as its own texture. Everything comes through
+// the Pak, so from the archive or from loose files.
+
+#define ATLAS_MAX_SPRITES 32
+#define ATLAS_MAX_TEXTURES (ATLAS_MAX_SPRITES + 1)
+
+// A region of a texture. source may be trimmed: it covers offset..offset +
+// source size of a size.x by size.y frame, the rest is transparent. Draw
+// calls take the frame rectangle.
+typedef struct Sprite {
+    Texture2D texture;
+    Rectangle source;
+    Vector2 offset;
+    Vector2 size;
+} Sprite;
+
+typedef struct Atlas {
+    Texture2D textures[ATLAS_MAX_TEXTURES];
+    int textureCount;
+
+    char names[ATLAS_MAX_SPRITES][32];
+    Sprite sprites[ATLAS_MAX_SPRITES];
+    int count;
+} Atlas;
+
+// Loads the sprites called names from dir (atlas.txt + its png, or single pngs)
+bool atlasLoad(Atlas *atlas, const Pak *pak, const char *dir, const char *const *names, int count);
+// Same with the atlas png already loaded (by the startup loader), the
+// Atlas takes it over. Id 0 loads it like atlasLoad.
+bool atlasLoadWith(Atlas *atlas, const Pak *pak, const char *dir, const char *const *names, int count, Texture2D texture);
+void atlasUnload(Atlas *atlas);
+
+// Empty sprite (texture id 0) if the name isn't loaded
+Sprite atlasSprite(const Atlas *atlas, const char *name);
+
+// The whole texture as a sprite
+Sprite spriteFromTexture(Texture2D texture);
+
+// Draws right away, dest is the untrimmed frame
+void spriteDraw(Sprite sprite, Rectangle dest, Color tint);
+// The part of dest the trimmed source covers
+Rectangle spriteTrimmedDest(Sprite sprite, Rectangle dest);
+
+// The asset bake premultiplies alpha, blend the sprites with this
+#ifdef ASSETS_PREMULTIPLIED
+#define SPRITE_BLEND_MODE BLEND_ALPHA_PREMULTIPLY
+#else
+#define SPRITE_BLEND_MODE BLEND_ALPHA
+#endif
+
+#endif
@@ -0,0 +1,170 @@
+// Build-time sprite atlas packer.
+//
+//   atlasPack [--trim] <out.png> <out.txt> <sprite.png>...
+//
+// Packs the sprites onto shelves in one RGBA image and writes a manifest
+// with one "name x y width height offsetX offsetY frameWidth frameHeight"
+// line per sprite, name being the file name without extension. --trim
+// cuts fully transparent borders off every sprite; the offset and frame
+// size say where the kept rectangle sat in the original image, so the
+// sprite still draws at its old size and position. Every sprite gets a
+// border copied from its own edge pixels so bilinear filtering never
+// picks up a neighbour.
+// Uses raylib's image functions only, no window is opened.
+
+#include <raylib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PADDING 2
+#define MAX_ATLAS_SIZE 4096
+
+typedef struct Entry {
+    const char *path;
+    char name[64];
+    Image image;
+    int x, y;
+    int offsetX, offsetY; // of the trimmed image in the original
+    int frameWidth, frameHeight; // original size
+} Entry;
+
+static int byHeight(const void *a, const void *b) {
+    const Entry *x = a, *y = b;
+    return y->image.height - x->image.height;
+}
+
+static void spriteName(const char *path, char *name, size_t size) {
+    const char *base = strrchr(path, '/');
+    const char *back = strrchr(path, '\\');
+    if(back && (!base || back > base)) base = back;
+    base = base ? base + 1 : path;
+
+    snprintf(name, size, "%s", base);
+    char *dot = strrchr(name, '.');
+    if(dot) *dot = '\0';
+}
+
+// shelf packing at a fixed width, returns the height used or -1
+static int pack(Entry *entries, int count, int width) {
+    int x = 0, y = 0, shelf = 0;
+    for(int i = 0; i < count; ++i) {
+        int w = entries[i].image.width + 2*PADDING;
+        int h = entries[i].image.height + 2*PADDING;
+        if(w > width) return -1;
+        if(x + w > width) {
+            x = 0;
+            y += shelf;
+            shelf = 0;
+        }
+        entries[i].x = x + PADDING;
+        entries[i].y = y + PADDING;
+        x += w;
+        if(h > shelf) shelf = h;
+    }
+    return y + shelf;
+}
+
+static int nextPow2(int v) {
+    int p = 1;
+    while(p < v) p <<= 1;
+    return p;
+}
+
+static void blit(Image *atlas, Image src, Rectangle from, float x, float y) {
+    ImageDraw(atlas, src, from, (Rectangle){x, y, from.width, from.height}, WHITE);
+}
+
+int main(int argc, char **argv) {
+    bool trim = argc > 1 && strcmp(argv[1], "--trim") == 0;
+    if(trim) {
+        --argc;
+        ++argv;
+    }
+    if(argc < 4) {
+        fprintf(stderr, "usage: %s [--trim] <out.png> <out.txt> <sprite.png>...\n", argv[0]);
+        return 1;
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+
+    int count = argc - 3;
+    Entry *entries = calloc(count, sizeof(Entry));
+    if(entries == NULL) return 1;
+
+    for(int i = 0; i < count; ++i) {
+        Entry *e = &entries[i];
+        e->path = argv[3 + i];
+        spriteName(e->path, e->name, sizeof(e->name));
+        e->image = LoadImage(e->path);
+        if(e->image.data == NULL) {
+            fprintf(stderr, "can't load %s\n", e->path);
+            return 1;
+        }
+        ImageFormat(&e->image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+        e->frameWidth = e->image.width;
+        e->frameHeight = e->image.height;
+
+        // a fully transparent sprite keeps its size, there's nothing to keep
+        Rectangle used = GetImageAlphaBorder(e->image, 0.0f);
+        if(trim && used.width > 0 && used.height > 0 && (used.width < e->image.width || used.height < e->image.height)) {
+            ImageCrop(&e->image, used);
+            e->offsetX = (int)used.x;
+            e->offsetY = (int)used.y;
+        }
+    }
+
+    qsort(entries, count, sizeof(Entry), byHeight);
+
+    // smallest power of two square-ish area that fits
+    int bestWidth = 0, bestHeight = 0;
+    for(int width = 64; width <= MAX_ATLAS_SIZE; width *= 2) {
+        int height = pack(entries, count, width);
+        if(height < 0) continue;
+        height = nextPow2(height);
+        if(height > MAX_ATLAS_SIZE) continue;
+        if(bestWidth == 0 || width*height < bestWidth*bestHeight) {
+            bestWidth = width;
+            bestHeight = height;
+        }
+    }
+    if(bestWidth == 0) {
+        fprintf(stderr, "sprites don't fit in %dx%d\n", MAX_ATLAS_SIZE, MAX_ATLAS_SIZE);
+        return 1;
+    }
+    pack(entries, count, bestWidth);
+
+    Image atlas = GenImageColor(bestWidth, bestHeight, BLANK);
+    FILE *manifest = fopen(argv[2], "w");
+    if(manifest == NULL) {
+        fprintf(stderr, "can't write %s\n", argv[2]);
+        return 1;
+    }
+    fprintf(manifest, "# %s %d %d\n", argv[1], bestWidth, bestHeight);
+
+    for(int i = 0; i < count; ++i) {
+        Entry *e = &entries[i];
+        float w = e->image.width, h = e->image.height;
+
+        // extrude the edges into the padding, then the sprite itself
+        for(int p = 1; p <= PADDING; ++p) {
+            blit(&atlas, e->image, (Rectangle){0, 0, w, 1}, e->x, e->y - p);
+            blit(&atlas, e->image, (Rectangle){0, h - 1, w, 1}, e->x, e->y + h - 1 + p);
+            blit(&atlas, e->image, (Rectangle){0, 0, 1, h}, e->x - p, e->y);
+            blit(&atlas, e->image, (Rectangle){w - 1, 0, 1, h}, e->x + w - 1 + p, e->y);
+        }
+        blit(&atlas, e->image, (Rectangle){0, 0, w, h}, e->x, e->y);
+
+        fprintf(manifest, "%s %d %d %d %d %d %d %d %d\n", e->name, e->x, e->y, e->image.width, e->image.height,
+                e->offsetX, e->offsetY, e->frameWidth, e->frameHeight);
+        UnloadImage(e->image);
+    }
+
+    bool ok = fclose(manifest) == 0;
+    ok = ExportImage(atlas, argv[1]) && ok;
+    UnloadImage(atlas);
+    free(entries);
+
+    if(!ok) fprintf(stderr, "can't write %s\n", argv[1]);
+    return ok ? 0 : 1;
+}
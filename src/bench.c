@@ -0,0 +1,466 @@
+// Microbenchmarks for the hot parts of a frame.
+//
+//   bench [--json out.json] [--baseline old.json] [--threshold 10] [--reps 30] [--no-gpu]
+//
+// Every metric is warmed up, then timed over --reps repetitions of a
+// fixed batch of iterations. Results are per operation in nanoseconds.
+// With --baseline, any metric whose median is more than --threshold
+// percent slower than the baseline's makes the exit code 1.
+
+#include <raylib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "sim.h"
+#include "parallax.h"
+#include "simBatch.h"
+#include "simRender.h"
+#include "spriteBatch.h"
+#include "textCache.h"
+
+#define MAX_METRICS 32
+#define MAX_REPS 1000
+
+typedef struct Metric {
+    const char *name;
+    double median;
+    double mean;
+    double stddev;
+    double min;
+    int reps;
+} Metric;
+
+typedef struct Bench {
+    Metric metrics[MAX_METRICS];
+    int count;
+    int reps;
+} Bench;
+
+static volatile uint64_t sink;
+
+static double nowNs(void) {
+    struct timespec ts;
+#if defined(_WIN32)
+    timespec_get(&ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+static int compareDouble(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Runs fn(ctx, iterations) once to warm up, then reps times timed
+static void measure(Bench *bench, const char *name, void (*fn)(void *ctx, int iterations), void *ctx, int iterations) {
+    double samples[MAX_REPS];
+
+    fn(ctx, iterations);
+
+    for(int r = 0; r < bench->reps; ++r) {
+        double start = nowNs();
+        fn(ctx, iterations);
+        samples[r] = (nowNs() - start)/iterations;
+    }
+
+    qsort(samples, bench->reps, sizeof(double), compareDouble);
+
+    Metric *m = &bench->metrics[bench->count++];
+    m->name = name;
+    m->reps = bench->reps;
+    m->min = samples[0];
+    m->median = bench->reps % 2 ? samples[bench->reps/2] : (samples[bench->reps/2 - 1] + samples[bench->reps/2])/2;
+
+    double sum = 0.0, sq = 0.0;
+    for(int r = 0; r < bench->reps; ++r) sum += samples[r];
+    m->mean = sum/bench->reps;
+    for(int r = 0; r < bench->reps; ++r) sq += (samples[r] - m->mean)*(samples[r] - m->mean);
+    m->stddev = bench->reps > 1 ? sqrt(sq/(bench->reps - 1)) : 0.0;
+
+    fprintf(stderr, "%-28s median %10.2f ns  mean %10.2f  stddev %8.2f  min %10.2f\n",
+            name, m->median, m->mean, m->stddev, m->min);
+}
+
+/* Simulation */
+
+typedef struct SimCtx {
+    SimWorld world;
+    SimBatch batch;
+    uint8_t *jumps;
+    uint64_t seed;
+} SimCtx;
+
+// keep the bird in the air so we time the normal path, not the dead early-out
+static bool botJump(const SimWorld *w) {
+    return w->birdY > w->config.screenHeight/2 && w->birdVel > 0;
+}
+
+static void benchSimStep(void *ctx, int iterations) {
+    SimCtx *c = ctx;
+    for(int i = 0; i < iterations; ++i) {
+        if(c->world.gameOver) simReset(&c->world, ++c->seed);
+        sink += simStep(&c->world, (SimInput){botJump(&c->world)}, SIM_TICK_DT);
+    }
+}
+
+// the swept step over a tenth of a second, what a headless run taking long steps pays
+static void benchSimStepSwept(void *ctx, int iterations) {
+    SimCtx *c = ctx;
+    for(int i = 0; i < iterations; ++i) {
+        if(c->world.gameOver) simReset(&c->world, ++c->seed);
+        sink += simStepSwept(&c->world, (SimInput){botJump(&c->world)}, 0.1f);
+    }
+}
+
+// botJump ahead of time: when the bird next falls past the middle
+static float botWait(const SimWorld *w, void *user, bool *jump) {
+    (void)user;
+    double y = w->birdY - w->config.screenHeight/2, v = w->birdVel, g = w->config.gravity;
+    *jump = true;
+    if(y > 0 && v > 0) return 0.0f;
+    if(g <= 0) return -1.0f;
+    // below the middle all the way up, at the top
+    double d = v*v - 2*g*y;
+    return (float)(d < 0 ? -v/g : (-v + sqrt(d))/g);
+}
+
+// ten simulated seconds event to event, against 600 sim_step calls
+static void benchRunEvents(void *ctx, int iterations) {
+    SimCtx *c = ctx;
+    for(int i = 0; i < iterations; ++i) {
+        if(c->world.gameOver) simReset(&c->world, ++c->seed);
+        sink += simRunEvents(&c->world, botWait, NULL, 10.0f);
+    }
+}
+
+// an 84x84 training frame with the parallax stand-in
+static void benchRender(void *ctx, int iterations) {
+    SimCtx *c = ctx;
+    static uint8_t pixels[84*84];
+    for(int i = 0; i < iterations; ++i) {
+        c->world.tick = i;
+        simRender(&c->world, pixels, 84, 84, SIM_RENDER_PARALLAX);
+        sink += pixels[i % (84*84)];
+    }
+}
+
+static void benchCollision(void *ctx, int iterations) {
+    SimCtx *c = ctx;
+    for(int i = 0; i < iterations; ++i) {
+        // nudge the bird so the compiler can't hoist the check
+        c->world.birdY = c->world.config.screenHeight/2 + (i & 63);
+        sink += simCheckCollision(&c->world);
+    }
+}
+
+static void benchBatchStep(void *ctx, int iterations) {
+    SimCtx *c = ctx;
+    SimBatch *b = &c->batch;
+    for(int i = 0; i < iterations; ++i) {
+        for(int w = 0; w < b->count; ++w) {
+            if(!b->alive[w]) simBatchReset(b, w, ++c->seed);
+            c->jumps[w] = b->birdY[w] > b->config.screenHeight/2 && b->birdVel[w] > 0;
+        }
+        simBatchStep(b, c->jumps, SIM_TICK_DT, NULL);
+    }
+    sink += b->score[0];
+}
+
+/* Per frame text */
+
+static void benchScoreText(void *ctx, int iterations) {
+    (void)ctx;
+    for(int i = 0; i < iterations; ++i) {
+        char scoreTxt[20];
+        sprintf(scoreTxt, "%d", i & 1023);
+        sink += MeasureText(scoreTxt, 60);
+    }
+}
+
+// the score changes every few hundred frames at most, 64 is generous
+static void benchScoreTextCached(void *ctx, int iterations) {
+    CachedText *text = ctx;
+    for(int i = 0; i < iterations; ++i) {
+        textCacheSetNumber(text, (i >> 6) & 1023);
+        sink += (uint64_t)text->size.x;
+    }
+}
+
+/* Draw submission into an offscreen target */
+
+typedef struct DrawCtx {
+    RenderTexture2D target;
+    Texture2D layers[3];
+    float scales[3];
+    Atlas atlas;
+    Sprite pipe;
+    SimWorld world;
+    SpriteBatch sprites;
+    Parallax parallax;
+} DrawCtx;
+
+static void benchDrawParallax(void *ctx, int iterations) {
+    DrawCtx *c = ctx;
+    for(int i = 0; i < iterations; ++i) {
+        BeginTextureMode(c->target);
+            ClearBackground(GetColor(0x052c46ff));
+            for(int l = 0; l < 3; ++l) {
+                float offset = -(float)(i % 100);
+                DrawTextureEx(c->layers[l], (Vector2){offset, 0}, 0.0f, c->scales[l], WHITE);
+                DrawTextureEx(c->layers[l], (Vector2){offset + c->layers[l].width*c->scales[l], 0}, 0.0f, c->scales[l], WHITE);
+            }
+        EndTextureMode();
+    }
+}
+
+// the same frame through parallax.c, one shader pass when GLSL 330 works
+static void benchDrawParallaxShader(void *ctx, int iterations) {
+    DrawCtx *c = ctx;
+    for(int i = 0; i < iterations; ++i) {
+        float offset = -(float)(i % 100);
+        BeginTextureMode(c->target);
+            spriteBatchBegin(&c->sprites);
+            parallaxDraw(&c->parallax, (float[]){offset, offset, offset}, &c->sprites, 0);
+            spriteBatchEnd(&c->sprites);
+        EndTextureMode();
+    }
+}
+
+static void benchDrawPipes(void *ctx, int iterations) {
+    DrawCtx *c = ctx;
+    const SimConfig *cfg = &c->world.config;
+    for(int i = 0; i < iterations; ++i) {
+        BeginTextureMode(c->target);
+            for(uint32_t k = 0; k < c->world.pipeCount; ++k) {
+                uint32_t p = simPipeSlot(&c->world, k);
+                float x = c->world.pipeX[p] - cfg->screenWidth + 100;
+                float gap = c->world.gapY[p];
+                spriteDraw(c->pipe, (Rectangle){x, 0, cfg->pipeWidth, gap - cfg->gapSize/2}, WHITE);
+                spriteDraw(c->pipe, (Rectangle){x, gap + cfg->gapSize/2, cfg->pipeWidth, cfg->screenHeight - (gap + cfg->gapSize/2)}, WHITE);
+            }
+        EndTextureMode();
+    }
+}
+
+// 100 pipe pairs through the sprite batch, the state change count is what we're after
+static void benchDrawPipesBatched(void *ctx, int iterations) {
+    DrawCtx *c = ctx;
+    const SimConfig *cfg = &c->world.config;
+    Sprite pipe = c->pipe;
+    for(int i = 0; i < iterations; ++i) {
+        BeginTextureMode(c->target);
+            spriteBatchBegin(&c->sprites);
+            for(int p = 0; p < 100; ++p) {
+                float x = (float)(p*14 % (int)cfg->screenWidth);
+                float gap = c->world.gapY[simPipeSlot(&c->world, p % c->world.pipeCount)];
+                spriteBatchDraw(&c->sprites, 1, pipe, (Rectangle){x, 0, cfg->pipeWidth, gap - cfg->gapSize/2}, WHITE);
+                spriteBatchDraw(&c->sprites, 1, pipe,
+                                (Rectangle){x, gap + cfg->gapSize/2, cfg->pipeWidth, cfg->screenHeight - (gap + cfg->gapSize/2)}, WHITE);
+            }
+            spriteBatchEnd(&c->sprites);
+        EndTextureMode();
+    }
+}
+
+/* Output */
+
+static bool writeJson(const Bench *bench, const char *path) {
+    FILE *out = path ? fopen(path, "w") : stdout;
+    if(out == NULL) return false;
+
+    fprintf(out, "{\n  \"unit\": \"ns\",\n  \"metrics\": [\n");
+    for(int i = 0; i < bench->count; ++i) {
+        const Metric *m = &bench->metrics[i];
+        fprintf(out, "    {\"name\": \"%s\", \"median\": %.3f, \"mean\": %.3f, \"stddev\": %.3f, \"min\": %.3f, \"reps\": %d}%s\n",
+                m->name, m->median, m->mean, m->stddev, m->min, m->reps, i + 1 < bench->count ? "," : "");
+    }
+    fprintf(out, "  ]\n}\n");
+
+    if(out != stdout) fclose(out);
+    return true;
+}
+
+// Pulls "median" for name out of a file written by writeJson
+static bool baselineMedian(const char *json, const char *name, double *median) {
+    char key[128];
+    snprintf(key, sizeof(key), "\"name\": \"%s\"", name);
+    const char *entry = strstr(json, key);
+    if(entry == NULL) return false;
+    const char *field = strstr(entry, "\"median\":");
+    if(field == NULL) return false;
+    return sscanf(field + strlen("\"median\":"), "%lf", median) == 1;
+}
+
+static int compareBaseline(const Bench *bench, const char *path, double threshold) {
+    FILE *file = fopen(path, "rb");
+    if(file == NULL) {
+        fprintf(stderr, "can't read baseline %s\n", path);
+        return 1;
+    }
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    char *json = malloc(size + 1);
+    size_t got = json ? fread(json, 1, size, file) : 0;
+    fclose(file);
+    if(json == NULL) return 1;
+    json[got] = '\0';
+
+    int regressions = 0;
+    for(int i = 0; i < bench->count; ++i) {
+        const Metric *m = &bench->metrics[i];
+        double base;
+        if(!baselineMedian(json, m->name, &base) || base <= 0.0) continue;
+
+        double change = (m->median - base)/base*100.0;
+        bool regressed = change > threshold;
+        regressions += regressed;
+        fprintf(stderr, "%-28s %10.2f -> %10.2f ns  %+6.1f%%%s\n", m->name, base, m->median, change, regressed ? "  REGRESSION" : "");
+    }
+    free(json);
+    return regressions ? 1 : 0;
+}
+
+int main(int argc, char **argv) {
+    const char *jsonPath = NULL;
+    const char *baselinePath = NULL;
+    double threshold = 10.0;
+    bool gpu = true;
+
+    Bench bench = {0};
+    bench.reps = 30;
+
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "--json") == 0 && i + 1 < argc) jsonPath = argv[++i];
+        else if(strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) baselinePath = argv[++i];
+        else if(strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) threshold = atof(argv[++i]);
+        else if(strcmp(argv[i], "--reps") == 0 && i + 1 < argc) bench.reps = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--no-gpu") == 0) gpu = false;
+        else {
+            fprintf(stderr, "usage: %s [--json file] [--baseline file] [--threshold percent] [--reps n] [--no-gpu]\n", argv[0]);
+            return 1;
+        }
+    }
+    if(bench.reps < 1) bench.reps = 1;
+    if(bench.reps > MAX_REPS) bench.reps = MAX_REPS;
+
+    SimCtx sim = {0};
+    SimConfig config = simDefaultConfig();
+    simInit(&sim.world, &config, 1);
+    sim.seed = 1;
+
+    measure(&bench, "sim_step", benchSimStep, &sim, 100000);
+    measure(&bench, "collision_check", benchCollision, &sim, 100000);
+    measure(&bench, "sim_step_swept_100ms", benchSimStepSwept, &sim, 10000);
+    measure(&bench, "sim_run_events_10s", benchRunEvents, &sim, 1000);
+    measure(&bench, "sim_render_84", benchRender, &sim, 10000);
+
+    // pixel collision with stand-in shapes: an oval bird, a pipe with a lip
+    uint8_t *pixels = calloc(120*720, 4);
+    if(pixels) {
+        SimMask birdMask, pipeMask;
+        for(int y = 0; y < 64; ++y) {
+            for(int x = 0; x < 64; ++x) {
+                float dx = (x - 31.5f)/26, dy = (y - 31.5f)/22;
+                pixels[(y*64 + x)*4 + 3] = dx*dx + dy*dy < 1 ? 255 : 0;
+            }
+        }
+        bool built = simMaskBuild(&birdMask, pixels, 64, 64, 128);
+        for(int y = 0; y < 720; ++y) {
+            for(int x = 0; x < 120; ++x) pixels[(y*120 + x)*4 + 3] = y < 40 || (x >= 8 && x < 112) ? 255 : 0;
+        }
+        built = simMaskBuild(&pipeMask, pixels, 120, 720, 128) && built;
+
+        if(built) {
+            SimConfig maskConfig = config;
+            maskConfig.birdMask = &birdMask;
+            maskConfig.pipeMask = &pipeMask;
+            SimCtx maskSim = {0};
+            simInit(&maskSim.world, &maskConfig, 1);
+            // park the first pipe on the bird so every check gets to the pixels
+            maskSim.world.pipeX[simPipeSlot(&maskSim.world, 0)] = maskSim.world.birdX - 60;
+            measure(&bench, "collision_check_pixels", benchCollision, &maskSim, 100000);
+        }
+        simMaskFree(&birdMask);
+        simMaskFree(&pipeMask);
+        free(pixels);
+    }
+
+    // a long course should step as fast as the endless pipes
+    const uint32_t courseLength = 10000;
+    SimObstacle *obstacles = malloc(courseLength*sizeof(SimObstacle));
+    if(obstacles) {
+        for(uint32_t i = 0; i < courseLength; ++i) {
+            obstacles[i] = (SimObstacle){config.screenWidth + i*config.pipeSpacing, simPipeGap(&config, 1, i)};
+        }
+        SimCourse course = {obstacles, courseLength};
+        SimConfig courseConfig = config;
+        courseConfig.course = &course;
+
+        SimCtx courseSim = {0};
+        simInit(&courseSim.world, &courseConfig, 1);
+        measure(&bench, "sim_step_course_10k", benchSimStep, &courseSim, 100000);
+        free(obstacles);
+    }
+
+    const int batchWorlds = 1024;
+    if(simBatchInit(&sim.batch, &config, batchWorlds)) {
+        sim.jumps = calloc(batchWorlds, 1);
+        for(int w = 0; w < batchWorlds; ++w) simBatchReset(&sim.batch, w, ++sim.seed);
+        measure(&bench, "batch_step_1024_worlds", benchBatchStep, &sim, 200);
+        free(sim.jumps);
+        simBatchFree(&sim.batch);
+    }
+
+    if(gpu) {
+        SetTraceLogLevel(LOG_WARNING);
+        SetConfigFlags(FLAG_WINDOW_HIDDEN);
+        InitWindow((int)config.screenWidth, (int)config.screenHeight, "bench");
+        ChangeDirectory(GetApplicationDirectory());
+
+        measure(&bench, "score_text", benchScoreText, NULL, 10000);
+        CachedText scoreText;
+        textCacheInit(&scoreText, 60, "0");
+        measure(&bench, "score_text_cached", benchScoreTextCached, &scoreText, 10000);
+
+        DrawCtx draw = {0};
+        draw.target = LoadRenderTexture((int)config.screenWidth, (int)config.screenHeight);
+        Pak pak;
+        pakOpen(&pak, GetApplicationDirectory());
+        draw.layers[0] = pakLoadTexture(&pak, "parallax/moon_back.png");
+        draw.layers[1] = pakLoadTexture(&pak, "parallax/moon_mid.png");
+        draw.layers[2] = pakLoadTexture(&pak, "parallax/moon_front.png");
+        for(int l = 0; l < 3; ++l) draw.scales[l] = config.screenHeight/draw.layers[l].height;
+        atlasLoad(&draw.atlas, &pak, "sprites", (const char *[]){"pipe"}, 1);
+        draw.pipe = atlasSprite(&draw.atlas, "pipe");
+        simInit(&draw.world, &config, 7);
+
+        measure(&bench, "draw_parallax", benchDrawParallax, &draw, 50);
+        parallaxInit(&draw.parallax, draw.layers, GetColor(0x052c46ff), config.screenWidth, config.screenHeight);
+        measure(&bench, draw.parallax.useShader ? "draw_parallax_shader" : "draw_parallax_fallback", benchDrawParallaxShader, &draw, 50);
+        parallaxUnload(&draw.parallax);
+        measure(&bench, "draw_pipes", benchDrawPipes, &draw, 200);
+        measure(&bench, "draw_pipes_batched_100", benchDrawPipesBatched, &draw, 200);
+
+        spriteBatchFree(&draw.sprites);
+        atlasUnload(&draw.atlas);
+        for(int l = 0; l < 3; ++l) UnloadTexture(draw.layers[l]);
+        UnloadRenderTexture(draw.target);
+        CloseWindow();
+        pakClose(&pak);
+    }
+
+    if(!writeJson(&bench, jsonPath)) {
+        fprintf(stderr, "can't write %s\n", jsonPath);
+        return 1;
+    }
+
+    return baselinePath ? compareBaseline(&bench, baselinePath, threshold) : 0;
+}
@@ -0,0 +1,21 @@
+#ifndef BITS_H
+#define BITS_H
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Bit scans for the lane masks, __builtin_ctz isn't there on MSVC
+
+// index of the lowest set bit, bits != 0
+static inline int lowestBit(int bits) {
+#if defined(_MSC_VER)
+    unsigned long i;
+    _BitScanForward(&i, (unsigned long)bits);
+    return (int)i;
+#else
+    return __builtin_ctz(bits);
+#endif
+}
+
+#endif
@@ -0,0 +1,237 @@
+#include "control.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+// polls before going to sleep on the futex, a few microseconds
+#define SPIN_COUNT 4000
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+static void cpuRelax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#endif
+}
+
+/* Futex */
+
+// shared between processes, so no FUTEX_PRIVATE_FLAG
+static void futexWait(_Atomic uint32_t *word, uint32_t value, double timeout) {
+    struct timespec ts = {(time_t)timeout, (long)((timeout - floor(timeout))*1e9)};
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAIT, value, &ts, NULL, 0);
+}
+
+static void futexWake(_Atomic uint32_t *word) {
+    syscall(SYS_futex, (uint32_t *)word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+// Bumps the word, waking whoever sleeps on it. Both sides are seq_cst, so
+// either the sleeper sees the new value or we see it waiting.
+static void post(_Atomic uint32_t *word, _Atomic uint32_t *waiting, uint32_t value) {
+    atomic_store(word, value);
+    if(atomic_load(waiting) > 0) futexWake(word);
+}
+
+typedef bool (*Ready)(const Control *control, uint32_t value, uint32_t arg);
+
+// on one core spinning only keeps the other side from running
+static int spinCount(void) {
+    static int count = -1;
+    if(count < 0) count = sysconf(_SC_NPROCESSORS_ONLN) > 1 ? SPIN_COUNT : 1;
+    return count;
+}
+
+// Waits for ready(word), up to timeout seconds. The last value seen goes
+// to *value either way.
+static bool await(const Control *control, _Atomic uint32_t *word, _Atomic uint32_t *waiting,
+                  Ready ready, uint32_t arg, double timeout, uint32_t *value) {
+    int spins = spinCount();
+    for(int i = 0; i < spins; ++i) {
+        *value = atomic_load(word);
+        if(ready(control, *value, arg)) return true;
+        if(timeout <= 0.0) return false;
+        cpuRelax();
+    }
+
+    double end = now() + timeout;
+    for(;;) {
+        atomic_fetch_add(waiting, 1);
+        *value = atomic_load(word);
+        bool done = ready(control, *value, arg);
+        double left = end - now();
+        if(!done && left > 0.0) futexWait(word, *value, left);
+        atomic_fetch_sub(waiting, 1);
+
+        *value = atomic_load(word);
+        if(done || ready(control, *value, arg)) return true;
+        if(now() >= end) return false;
+    }
+}
+
+/* Setup */
+
+// "/name" either way
+static void objectName(Control *control, const char *name) {
+    snprintf(control->name, sizeof(control->name), "/%s", name[0] == '/' ? name + 1 : name);
+}
+
+bool controlCreate(Control *control, const char *name, bool lockstep) {
+    memset(control, 0, sizeof(*control));
+    objectName(control, name);
+
+    int fd = shm_open(control->name, O_CREAT | O_RDWR, 0600);
+    if(fd < 0) return false;
+    void *data = MAP_FAILED;
+    if(ftruncate(fd, sizeof(ControlShared)) == 0) {
+        data = mmap(NULL, sizeof(ControlShared), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd); // the mapping keeps it
+    if(data == MAP_FAILED) {
+        shm_unlink(control->name);
+        return false;
+    }
+
+    // a previous game's object is started over
+    ControlShared *shared = data;
+    memset(shared, 0, sizeof(*shared));
+    shared->version = CONTROL_VERSION;
+    shared->size = sizeof(*shared);
+    shared->lockstep = lockstep;
+    atomic_thread_fence(memory_order_release);
+    shared->magic = CONTROL_MAGIC;
+
+    control->shared = shared;
+    control->owner = true;
+    control->lockstep = lockstep;
+    return true;
+}
+
+bool controlAttach(Control *control, const char *name) {
+    memset(control, 0, sizeof(*control));
+    objectName(control, name);
+
+    int fd = shm_open(control->name, O_RDWR, 0);
+    if(fd < 0) return false;
+    struct stat st;
+    void *data = MAP_FAILED;
+    if(fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(ControlShared)) {
+        data = mmap(NULL, sizeof(ControlShared), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if(data == MAP_FAILED) return false;
+
+    ControlShared *shared = data;
+    bool ok = shared->magic == CONTROL_MAGIC;
+    atomic_thread_fence(memory_order_acquire);
+    if(!ok || shared->version != CONTROL_VERSION || shared->size != sizeof(*shared)) {
+        munmap(data, sizeof(ControlShared));
+        return false;
+    }
+
+    control->shared = shared;
+    control->lockstep = shared->lockstep != 0;
+    control->lastAnswer = atomic_load(&shared->answer);
+    return true;
+}
+
+void controlClose(Control *control) {
+    if(control->shared) munmap(control->shared, sizeof(ControlShared));
+    if(control->owner) shm_unlink(control->name);
+    memset(control, 0, sizeof(*control));
+}
+
+/* Game */
+
+void controlPublish(Control *control, const SimWorld *world, bool running) {
+    ControlShared *shared = control->shared;
+    uint32_t seq = atomic_load_explicit(&shared->published, memory_order_relaxed);
+
+    // readers still copying the state that was here see the seq change
+    ControlState *state = &shared->ring[seq % CONTROL_RING];
+    atomic_store_explicit(&state->seq, ~seq, memory_order_release);
+    atomic_thread_fence(memory_order_release);
+    state->tick = world->tick;
+    state->flags = (running ? CONTROL_RUNNING : 0) | (world->gameOver ? CONTROL_GAME_OVER : 0);
+    state->score = world->score;
+    state->birdX = world->birdX;
+    state->birdY = world->birdY;
+    state->birdVel = world->birdVel;
+
+    // the ones still to pass, nearest first
+    uint32_t first;
+    uint32_t count = simPipesInSpan(world, world->birdX, INFINITY, &first);
+    if(count > CONTROL_PIPES) count = CONTROL_PIPES;
+    state->pipeCount = count;
+    for(uint32_t k = 0; k < CONTROL_PIPES; ++k) {
+        uint32_t i = simPipeSlot(world, first + k);
+        state->pipeX[k] = k < count ? world->pipeX[i] : 0.0f;
+        state->gapY[k] = k < count ? world->gapY[i] : 0.0f;
+    }
+    atomic_store_explicit(&state->seq, seq, memory_order_release);
+
+    post(&shared->published, &shared->agentWaiting, seq + 1);
+}
+
+static bool newAnswer(const Control *control, uint32_t answer, uint32_t arg) {
+    (void)arg;
+    if(answer == control->lastAnswer) return false;
+    if(!control->lockstep) return true;
+    // in lockstep only the answer to the newest state will do
+    uint32_t published = atomic_load(&control->shared->published);
+    return answer >> 8 == (published & 0xffffff);
+}
+
+bool controlTakeAction(Control *control, double timeout, int *action) {
+    ControlShared *shared = control->shared;
+    uint32_t answer;
+    if(!await(control, &shared->answer, &shared->gameWaiting, newAnswer, 0, timeout, &answer)) return false;
+
+    control->lastAnswer = answer;
+    *action = answer & 0xff;
+    return true;
+}
+
+/* Agent */
+
+uint32_t controlPublished(const Control *control) {
+    return atomic_load(&control->shared->published);
+}
+
+static bool isOut(const Control *control, uint32_t published, uint32_t seq) {
+    (void)control;
+    return (int32_t)(published - seq) > 0;
+}
+
+bool controlWaitState(Control *control, uint32_t seq, double timeout, ControlState *state) {
+    ControlShared *shared = control->shared;
+    uint32_t published;
+    if(!await(control, &shared->published, &shared->agentWaiting, isOut, seq, timeout, &published)) return false;
+    if(published - seq > CONTROL_RING) return false;
+
+    // the seqlock read, once the slot moves on from seq it never comes back
+    const ControlState *slot = &shared->ring[seq % CONTROL_RING];
+    if(atomic_load_explicit(&slot->seq, memory_order_acquire) != seq) return false;
+    memcpy(state, slot, sizeof(*state));
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit(&slot->seq, memory_order_relaxed) == seq;
+}
+
+void controlAnswer(Control *control, uint32_t seq, int action) {
+    ControlShared *shared = control->shared;
+    post(&shared->answer, &shared->gameWaiting, ((seq + 1) & 0xffffff) << 8 | (action & 0xff));
+}
@@ -0,0 +1,105 @@
+#ifndef CONTROL_H
+#define CONTROL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sim.h"
+
+// Lets another process play. With app --control NAME the game publishes
+// the world after every tick into the POSIX shared memory object /NAME,
+// and the agent answers each state with an action in the same mapping.
+// Nothing is serialized: both sides read and write the structs below in
+// place. A ring slot is a seqlock, the game sets its seq to ~n, writes
+// state n and then sets seq to n, both with release. A reader copies the
+// slot, fences with acquire and reads seq again: unless it's the n it
+// wanted both times, the slot was being rewritten and the copy is torn.
+// controlWaitState does that. Waits spin for a moment and then sleep on a futex, the other side
+// only makes the wake syscall when someone sleeps, so a round trip stays
+// in the microseconds while both are busy.
+//
+// Free running, the game ticks on its clock and a jump in the newest
+// answer is taken on the next tick. In lockstep (--lockstep) a tick only
+// happens once the agent has answered the state before it, as fast as it
+// answers.
+//
+// Between runs (the menu, game over) an answer with CONTROL_RESTART
+// starts the next one. Linux only, futexes.
+
+#define CONTROL_MAGIC 0x4c544346u // "FCTL"
+#define CONTROL_VERSION 1
+#define CONTROL_RING 64 // states kept, older ones are overwritten
+#define CONTROL_PIPES 3 // from the first one the bird hasn't passed
+
+// answers
+enum {
+    CONTROL_JUMP = 1 << 0,
+    CONTROL_RESTART = 1 << 1
+};
+
+// ControlState.flags
+enum {
+    CONTROL_RUNNING = 1 << 0, // started and not over, answers are jumps
+    CONTROL_GAME_OVER = 1 << 1
+};
+
+typedef struct ControlState {
+    _Atomic uint32_t seq; // which state this is, ~n while state n is written
+    uint32_t tick;
+    uint32_t flags;
+    int32_t score;
+    float birdX, birdY, birdVel;
+    uint32_t pipeCount; // of pipeX/gapY in use
+    float pipeX[CONTROL_PIPES];
+    float gapY[CONTROL_PIPES];
+} ControlState;
+
+// The mapping. The counters sit on their own cache lines.
+typedef struct ControlShared {
+    uint32_t magic; // written last, once the rest is set up
+    uint32_t version;
+    uint32_t size; // sizeof(ControlShared)
+    uint32_t lockstep;
+
+    // game -> agent: states published so far, state n is ring[n % CONTROL_RING]
+    _Alignas(64) _Atomic uint32_t published;
+    _Atomic uint32_t agentWaiting;
+
+    // agent -> game: (seq + 1) << 8 | action for the newest state answered,
+    // seq taken to 24 bits
+    _Alignas(64) _Atomic uint32_t answer;
+    _Atomic uint32_t gameWaiting;
+
+    _Alignas(64) ControlState ring[CONTROL_RING];
+} ControlShared;
+
+typedef struct Control {
+    ControlShared *shared;
+    char name[64];
+    bool owner; // the game, it unlinks the object
+    bool lockstep;
+    uint32_t lastAnswer;
+} Control;
+
+// Game side: creates (or takes over) /name. false if it can't.
+bool controlCreate(Control *control, const char *name, bool lockstep);
+// Agent side: maps an existing /name. false if it isn't there or isn't ours.
+bool controlAttach(Control *control, const char *name);
+void controlClose(Control *control);
+
+// Game: the world as the next state, running is gameStarted && !gameOver
+void controlPublish(Control *control, const SimWorld *world, bool running);
+// Game: a new answer, waiting up to timeout seconds for it. In lockstep it
+// has to be the answer to the newest state. false if there's none.
+bool controlTakeAction(Control *control, double timeout, int *action);
+
+// Agent: how many states there are so far, the newest is one less
+uint32_t controlPublished(const Control *control);
+// Agent: copies state seq to *state once it's out, waiting up to timeout
+// seconds. false on timeout, or once it has been overwritten (even halfway
+// through the copy).
+bool controlWaitState(Control *control, uint32_t seq, double timeout, ControlState *state);
+// Agent: the action for state seq
+void controlAnswer(Control *control, uint32_t seq, int action);
+
+#endif
@@ -0,0 +1,105 @@
+// Plays a running app --control NAME from outside with the runner's gap
+// heuristic, and reports each run's score and the round trips, e.g.
+//
+//   app --control flappy --lockstep &
+//   controlAgent flappy --runs 10
+//
+// A starting point for harnesses, and a check that the game answers.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "control.h"
+#include "sim.h"
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+// jump when the bird drops below the middle of the next gap
+static bool heuristicJump(const SimConfig *c, const ControlState *state) {
+    float target = state->pipeCount ? state->gapY[0] : c->screenHeight/2;
+    return state->birdY > target + c->gapSize/8 && state->birdVel >= 0.0f;
+}
+
+int main(int argc, char **argv) {
+    if(argc < 2) {
+        fprintf(stderr, "usage: %s NAME [--runs N]\n", argv[0]);
+        return 1;
+    }
+    int runs = 0; // forever
+    for(int i = 2; i < argc; ++i) {
+        if(strcmp(argv[i], "--runs") == 0 && i + 1 < argc) runs = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s NAME [--runs N]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    Control control;
+    if(!controlAttach(&control, argv[1])) {
+        fprintf(stderr, "no game at /%s, start app --control %s first\n", argv[1], argv[1]);
+        return 1;
+    }
+    SimConfig config = simDefaultConfig();
+    printf("attached to /%s, %s\n", argv[1], control.lockstep ? "lockstep" : "free running");
+
+    uint32_t published = controlPublished(&control);
+    uint32_t seq = published ? published - 1 : 0;
+    int played = 0;
+    double answered = 0.0, tripSum = 0.0, tripMax = 0.0;
+    uint64_t trips = 0;
+
+    while(runs == 0 || played < runs) {
+        ControlState state;
+        if(!controlWaitState(&control, seq, 1.0, &state)) {
+            // fell a ring behind, or nothing is happening
+            published = controlPublished(&control);
+            if(published - seq >= CONTROL_RING) seq = published - 1;
+            continue;
+        }
+
+        // the last answer to this state, the game's side of a round trip.
+        // Free running or between runs it waits for its frame instead.
+        if(control.lockstep && answered > 0.0) {
+            double trip = now() - answered;
+            tripSum += trip;
+            if(trip > tripMax) tripMax = trip;
+            ++trips;
+        }
+
+        int action = 0;
+        if(state.flags & CONTROL_RUNNING) {
+            if(heuristicJump(&config, &state)) action = CONTROL_JUMP;
+        } else {
+            if(state.flags & CONTROL_GAME_OVER) {
+                ++played;
+                printf("run %d: score %d, %.1f s, round trip %.1f us mean %.1f us max\n", played, state.score,
+                       (float)state.tick/SIM_TICK_RATE, trips ? tripSum/trips*1e6 : 0.0, tripMax*1e6);
+                tripSum = tripMax = 0.0;
+                trips = 0;
+            }
+            action = CONTROL_RESTART;
+        }
+        controlAnswer(&control, seq, action);
+        answered = state.flags & CONTROL_RUNNING ? now() : 0.0;
+
+        // free running, the newest state is the one to answer
+        ++seq;
+        uint32_t newest = controlPublished(&control) - 1;
+        if((int32_t)(newest - seq) > 0) {
+            seq = newest;
+            answered = 0.0;
+        }
+    }
+
+    controlClose(&control);
+    return 0;
+}
@@ -0,0 +1,264 @@
+#include "loader.h"
+
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "mixer.h"
+
+#define PAGE_SIZE 4096
+
+static double now(void) {
+    struct timespec ts;
+#if defined(_WIN32)
+    timespec_get(&ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+double loaderTime(const Loader *loader) {
+    return now() - loader->origin;
+}
+
+void loaderInit(Loader *loader) {
+    memset(loader, 0, sizeof(*loader));
+    loader->origin = now();
+    pthread_mutex_init(&loader->lock, NULL);
+    pthread_cond_init(&loader->wake, NULL);
+}
+
+static void setState(Loader *loader, LoaderJob *job, int state) {
+    pthread_mutex_lock(&loader->lock);
+    job->state = state;
+    pthread_mutex_unlock(&loader->lock);
+}
+
+static int getState(Loader *loader, const LoaderJob *job) {
+    pthread_mutex_lock(&loader->lock);
+    int state = job->state;
+    pthread_mutex_unlock(&loader->lock);
+    return state;
+}
+
+/* Workers */
+
+// LoadImage/LoadWave look at the extension through a shared buffer, the
+// FromMemory versions only compare it
+static const char *extension(const char *path) {
+    const char *dot = strrchr(path, '.');
+    return dot ? dot : "";
+}
+
+// reads a page of each so the upload doesn't wait on the disk
+static void pageIn(const void *data, size_t size) {
+    const volatile uint8_t *p = data;
+    uint8_t sum = 0;
+    for(size_t i = 0; i < size; i += PAGE_SIZE) sum += p[i];
+    (void)sum;
+}
+
+static void decodeTexture(LoaderJob *job) {
+    if(job->inPak && pakImage(&job->entry, &job->image)) {
+        pageIn(job->entry.data, job->entry.size);
+        return;
+    }
+
+    int size = 0;
+    unsigned char *data = LoadFileData(job->path, &size);
+    if(data == NULL) return;
+    job->image = LoadImageFromMemory(extension(job->path), data, size);
+    job->ownsImage = true;
+    UnloadFileData(data);
+}
+
+static void decodeWave(LoaderJob *job) {
+    if(job->inPak && job->entry.type == PAK_RAW) {
+        job->wave = LoadWaveFromMemory(extension(job->name), job->entry.data, (int)job->entry.size);
+    } else {
+        int size = 0;
+        unsigned char *data = LoadFileData(job->path, &size);
+        if(data == NULL) return;
+        job->wave = LoadWaveFromMemory(extension(job->path), data, size);
+        UnloadFileData(data);
+    }
+    // resampling is most of the work, better here than in mixerAddWave
+    if(job->wave.data) WaveFormat(&job->wave, MIXER_SAMPLE_RATE, 16, 2);
+}
+
+static void decode(Loader *loader, LoaderJob *job) {
+    job->decodeStart = loaderTime(loader);
+    if(job->type == LOADER_TEXTURE) decodeTexture(job);
+    else decodeWave(job);
+    job->decodeEnd = loaderTime(loader);
+}
+
+static void *worker(void *arg) {
+    Loader *loader = arg;
+
+    pthread_mutex_lock(&loader->lock);
+    int thread = loader->threadIds++;
+    for(;;) {
+        while(loader->next >= loader->count && !loader->closing) pthread_cond_wait(&loader->wake, &loader->lock);
+        if(loader->next >= loader->count) break;
+
+        LoaderJob *job = &loader->jobs[loader->next++];
+        job->state = LOADER_DECODING;
+        pthread_mutex_unlock(&loader->lock);
+
+        job->thread = thread;
+        decode(loader, job);
+
+        pthread_mutex_lock(&loader->lock);
+        job->state = LOADER_DECODED;
+    }
+    pthread_mutex_unlock(&loader->lock);
+    return NULL;
+}
+
+/* Main thread */
+
+static int cores(void) {
+#ifdef _WIN32
+    return 2;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+#endif
+}
+
+void loaderStart(Loader *loader, int threads) {
+    if(threads <= 0) threads = cores() - 1;
+    if(threads < 1) threads = 1;
+    if(threads > LOADER_MAX_THREADS) threads = LOADER_MAX_THREADS;
+
+    for(int i = 0; i < threads; ++i) {
+        if(pthread_create(&loader->threads[loader->threadCount], NULL, worker, loader) != 0) break;
+        ++loader->threadCount;
+    }
+    if(loader->threadCount == 0) TraceLog(LOG_WARNING, "LOADER: no worker threads, loading on the main thread");
+}
+
+static int addJob(Loader *loader, const Pak *pak, const char *name, int type) {
+    if(loader->count == LOADER_MAX_JOBS) return -1;
+
+    // filled in before the workers can see it
+    LoaderJob *job = &loader->jobs[loader->count];
+    memset(job, 0, sizeof(*job));
+    job->type = type;
+    snprintf(job->name, sizeof(job->name), "%s", name);
+    job->inPak = pakFind(pak, name, &job->entry);
+    snprintf(job->path, sizeof(job->path), "%s", type == LOADER_TEXTURE ? pakTexturePath(pak, name) : pakPath(pak, name));
+    job->queued = loaderTime(loader);
+
+    pthread_mutex_lock(&loader->lock);
+    int handle = loader->count++;
+    pthread_cond_signal(&loader->wake);
+    pthread_mutex_unlock(&loader->lock);
+    return handle;
+}
+
+int loaderAddTexture(Loader *loader, const Pak *pak, const char *name) {
+    return addJob(loader, pak, name, LOADER_TEXTURE);
+}
+
+int loaderAddWave(Loader *loader, const Pak *pak, const char *name) {
+    return addJob(loader, pak, name, LOADER_WAVE);
+}
+
+static void upload(Loader *loader, LoaderJob *job) {
+    double start = loaderTime(loader);
+    if(job->type == LOADER_TEXTURE && job->image.data) {
+        job->texture = LoadTextureFromImage(job->image);
+        if(job->texture.mipmaps > 1) SetTextureFilter(job->texture, TEXTURE_FILTER_TRILINEAR);
+        if(job->ownsImage) UnloadImage(job->image);
+        job->image = (Image){0};
+    }
+    job->failed = job->type == LOADER_TEXTURE ? job->texture.id == 0 : job->wave.data == NULL;
+    job->ready = loaderTime(loader);
+    job->uploadTime = job->ready - start;
+    setState(loader, job, LOADER_DONE);
+    ++loader->done;
+}
+
+bool loaderUpdate(Loader *loader, double budget) {
+    double start = loaderTime(loader);
+    bool uploaded = false;
+    for(int i = 0; i < loader->count; ++i) {
+        LoaderJob *job = &loader->jobs[i];
+        if(loader->threadCount == 0 && job->state == LOADER_QUEUED) {
+            // no workers, or loaderFinish after they're gone
+            if(uploaded && loaderTime(loader) - start >= budget) break;
+            decode(loader, job);
+            job->state = LOADER_DECODED;
+        }
+        if(getState(loader, job) != LOADER_DECODED) continue;
+        if(uploaded && loaderTime(loader) - start >= budget) break;
+
+        upload(loader, job);
+        uploaded = uploaded || job->type == LOADER_TEXTURE;
+    }
+    return loader->done == loader->count;
+}
+
+float loaderProgress(const Loader *loader) {
+    return loader->count ? (float)loader->done/loader->count : 1.0f;
+}
+
+void loaderFinish(Loader *loader) {
+    pthread_mutex_lock(&loader->lock);
+    loader->closing = true;
+    pthread_cond_broadcast(&loader->wake);
+    pthread_mutex_unlock(&loader->lock);
+
+    // workers drain the queue before they exit
+    for(int i = 0; i < loader->threadCount; ++i) pthread_join(loader->threads[i], NULL);
+    loader->threadCount = 0;
+
+    // anything still queued (no workers ever started) is decoded here
+    loaderUpdate(loader, INFINITY);
+
+    pthread_cond_destroy(&loader->wake);
+    pthread_mutex_destroy(&loader->lock);
+}
+
+Texture2D loaderTexture(const Loader *loader, int handle) {
+    if(handle < 0 || handle >= loader->count) return (Texture2D){0};
+    return loader->jobs[handle].texture;
+}
+
+Wave loaderTakeWave(Loader *loader, int handle) {
+    if(handle < 0 || handle >= loader->count) return (Wave){0};
+    Wave wave = loader->jobs[handle].wave;
+    loader->jobs[handle].wave = (Wave){0};
+    return wave;
+}
+
+/* Report */
+
+void loaderMark(Loader *loader, const char *name) {
+    if(loader->markCount == LOADER_MAX_MARKS) return;
+    loader->markNames[loader->markCount] = name;
+    loader->marks[loader->markCount++] = loaderTime(loader);
+}
+
+void loaderReport(const Loader *loader, FILE *out) {
+    fprintf(out, "startup\n");
+    for(int i = 0; i < loader->markCount; ++i) {
+        fprintf(out, "  %-24s %8.1f ms\n", loader->markNames[i], loader->marks[i]*1e3);
+    }
+
+    fprintf(out, "assets (%d worker threads)\n", loader->threadIds);
+    fprintf(out, "  %-32s %6s %9s %9s %9s %9s\n", "name", "source", "wait ms", "decode ms", "upload ms", "ready ms");
+    for(int i = 0; i < loader->count; ++i) {
+        const LoaderJob *job = &loader->jobs[i];
+        fprintf(out, "  %-32s %6s %9.2f %9.2f %9.2f %9.1f%s\n", job->name, job->inPak ? "pak" : "file",
+                (job->decodeStart - job->queued)*1e3, (job->decodeEnd - job->decodeStart)*1e3,
+                job->uploadTime*1e3, job->ready*1e3, job->failed ? "  FAILED" : "");
+    }
+}
@@ -0,0 +1,112 @@
+#ifndef LOADER_H
+#define LOADER_H
+
+#include <pthread.h>
+#include <raylib.h>
+#include <stdbool.h>
+#include <stdio.h>
+
+#include "pak.h"
+
+// Startup asset loading off the main thread. Worker threads decode
+// images and waves in parallel (PNG/WAV for loose files; for archive
+// entries there's nothing to decode, the worker only pages them in) and
+// the main thread uploads finished images to the GPU a few per frame in
+// loaderUpdate, so the window can draw a loading screen meanwhile. Every
+// asset's decode and upload time is kept for loaderReport, along with
+// milestones like the first frame.
+//
+// Everything but the workers runs on the main thread. Paths are resolved
+// when an asset is added, the workers never touch raylib's shared text
+// buffers.
+
+#define LOADER_MAX_JOBS 32
+#define LOADER_MAX_THREADS 4
+#define LOADER_MAX_MARKS 8
+
+enum {
+    LOADER_TEXTURE,
+    LOADER_WAVE
+};
+
+enum {
+    LOADER_QUEUED,
+    LOADER_DECODING,
+    LOADER_DECODED,
+    LOADER_DONE
+};
+
+typedef struct LoaderJob {
+    int type;
+    char name[64];
+    char path[256]; // loose file, if the archive doesn't have it
+    PakEntry entry;
+    bool inPak;
+
+    // under the lock
+    int state;
+
+    // written by the worker before LOADER_DECODED
+    Image image;
+    bool ownsImage; // else it points into the archive
+    Wave wave;
+    int thread;
+    double decodeStart, decodeEnd;
+
+    // main thread
+    Texture2D texture;
+    bool failed;
+    double queued, uploadTime, ready;
+} LoaderJob;
+
+typedef struct Loader {
+    LoaderJob jobs[LOADER_MAX_JOBS];
+    int count;
+    int done;
+    double origin;
+
+    const char *markNames[LOADER_MAX_MARKS];
+    double marks[LOADER_MAX_MARKS];
+    int markCount;
+
+    pthread_t threads[LOADER_MAX_THREADS];
+    int threadCount;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    // under lock
+    int next; // next job a worker takes
+    int threadIds; // handed out as workers start
+    bool closing;
+} Loader;
+
+// Times are from here on, call it first thing
+void loaderInit(Loader *loader);
+// Starts the workers, threads <= 0 for one less than the cores. Jobs can
+// be added before or after.
+void loaderStart(Loader *loader, int threads);
+// Waits for the rest, uploads it and stops the workers
+void loaderFinish(Loader *loader);
+
+// Handles for loaderTexture/loaderTakeWave, -1 if the queue is full
+int loaderAddTexture(Loader *loader, const Pak *pak, const char *name);
+int loaderAddWave(Loader *loader, const Pak *pak, const char *name);
+
+// Uploads decoded textures for up to budget seconds (at least one).
+// true once every job is done.
+bool loaderUpdate(Loader *loader, double budget);
+// 0..1, done jobs
+float loaderProgress(const Loader *loader);
+
+// Id 0 if it isn't loaded (yet) or failed. The caller owns it.
+Texture2D loaderTexture(const Loader *loader, int handle);
+// The decoded wave, formatted for the mixer. The caller owns it, a
+// second call gets an empty one.
+Wave loaderTakeWave(Loader *loader, int handle);
+
+// Seconds since loaderInit
+double loaderTime(const Loader *loader);
+// Records a milestone for the report, name must outlive the loader
+void loaderMark(Loader *loader, const char *name);
+void loaderReport(const Loader *loader, FILE *out);
+
+#endif
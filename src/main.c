@@ -1,69 +1,249 @@
 #include <raylib.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include <math.h>
 
-#define MAX_PIPES 5
-#define GRAVITY 1000.0f
-#define JUMP_FORCE -375.0f
-#define SOUND_INSTANCES 3
+#include "atlas.h"
+#include "loader.h"
+#include "mixer.h"
+#include "music.h"
+#include "pak.h"
+#include "parallax.h"
+#include "profiler.h"
+#include "replay.h"
+#include "sim.h"
+#include "spriteBatch.h"
+#include "textCache.h"
+
+#ifdef FLAPPY_CONTROL
+#include <limits.h>
+#include "control.h"
+#endif
+
+// how many sounds may overlap before the oldest is cut, --voices overrides
+#define DEFAULT_VOICES 8
+
+// Sprite batch layers, back to front
+enum {
+    LAYER_BACKGROUND,
+    LAYER_MIDGROUND,
+    LAYER_FOREGROUND,
+    LAYER_BIRD,
+    LAYER_PIPES
+};
+
+// fresh seed for a new run, pipe gaps are derived from it
+uint64_t randomSeed(void) {
+    return (uint64_t)GetRandomValue(0, 0x7fffffff) << 32 ^ (uint64_t)GetRandomValue(0, 0x7fffffff);
+}
+
+// a baked music track, played from the mapped archive when it's in there
+int loadTrack(const Pak *pak, const char *name) {
+    PakEntry entry;
+    if(pakFind(pak, name, &entry)) return musicLoadMemory(entry.data, entry.size, name);
+    return musicLoad(pakPath(pak, name));
+}
+
+// Solid pixels of a sprite the way it's drawn, from its texture's pixels:
+// the untrimmed frame, width wide
+bool spriteMask(Image pixels, Sprite sprite, int width, SimMask *mask) {
+    *mask = (SimMask){0};
+    if(pixels.data == NULL) return false;
+
+    Image image = ImageFromImage(pixels, sprite.source);
+    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    ImageResizeCanvas(&image, sprite.size.x, sprite.size.y, sprite.offset.x, sprite.offset.y, BLANK);
+    if(image.width != width) ImageResizeNN(&image, width, image.height);
+    bool built = simMaskBuild(mask, image.data, image.width, image.height, 128);
+    UnloadImage(image);
+    return built;
+}
+
+// The game over image and sound, decoded on a worker once the first run
+// starts instead of in the frame the bird dies
+typedef struct GameOver {
+    Loader loader;
+    bool queued, loaded;
+    int image, wave; // loader handles, wave -1 if the bank has the sound
+    Sprite sprite;
+    int sound;
+} GameOver;
+
+void gameOverQueue(GameOver *gameOver, const Pak *pak) {
+    if(gameOver->queued) return;
+    loaderInit(&gameOver->loader);
+    gameOver->image = loaderAddTexture(&gameOver->loader, pak, "sprites/gameOver.png");
+    // nothing to decode if it's in the bank, cross builds only have the wav
+    gameOver->sound = mixerFind(pakPath(pak, "sound/gameOver/gameOver.wav"));
+    gameOver->wave = gameOver->sound < 0 ? loaderAddWave(&gameOver->loader, pak, "sound/gameOver/gameOver.wav") : -1;
+    loaderStart(&gameOver->loader, 1);
+    gameOver->queued = true;
+}
 
-Vector2 centerText(const char *text, int fontSize, int screenWidth, int screenHeight) {
-    Vector2 position;
-    position.x = screenWidth/2 - MeasureText(text, fontSize)/2;
-    position.y = screenHeight/2 - fontSize/2;
-    return position;
+// Uploads it once it's decoded, wait finishes the decode first. true once
+// it's in.
+bool gameOverUpdate(GameOver *gameOver, bool wait) {
+    if(!gameOver->queued || gameOver->loaded) return gameOver->loaded;
+    if(!wait && !loaderUpdate(&gameOver->loader, 0.002)) return false;
+    loaderFinish(&gameOver->loader);
+
+    gameOver->sprite = spriteFromTexture(loaderTexture(&gameOver->loader, gameOver->image));
+    if(gameOver->wave >= 0) gameOver->sound = mixerAddWave(loaderTakeWave(&gameOver->loader, gameOver->wave));
+    gameOver->loaded = true;
+    return true;
 }
 
-int main(void) {
+// what the window shows while the assets load
+void drawLoading(int screenWidth, int screenHeight, float progress) {
+    BeginDrawing();
+        ClearBackground(GetColor(0x052c46ff));
+        DrawText("LOADING", screenWidth/2 - MeasureText("LOADING", 30)/2, screenHeight/2 - 40, 30, RAYWHITE);
+        Rectangle bar = {screenWidth/2 - 150, screenHeight/2 + 10, 300, 12};
+        DrawRectangleRec((Rectangle){bar.x, bar.y, bar.width*progress, bar.height}, RAYWHITE);
+        DrawRectangleLinesEx(bar, 2, RAYWHITE);
+    EndDrawing();
+}
+
+int main(int argc, char **argv) {
+    // startup times count from here, --startup-report prints them
+    Loader loader;
+    loaderInit(&loader);
 
     const int screenHeight = 720, screenWidth = 1400;
 
-    // Create a window
-    InitWindow(screenWidth,screenHeight,"FLAPPY-BIRD");
+    // --record <file> saves the last finished run, --replay <file> plays one back
+    const char *recordPath = NULL;
+    const char *replayPath = NULL;
+    int voices = DEFAULT_VOICES;
+    bool startupReport = false;
+    // --control <name> lets another process play through shared memory,
+    // --lockstep makes the game wait for it every tick
+    const char *controlName = NULL;
+    bool lockstep = false;
+    for(int i = 1; i < argc; ++i) {
+        if(strcmp(argv[i], "--record") == 0 && i + 1 < argc) recordPath = argv[++i];
+        else if(strcmp(argv[i], "--replay") == 0 && i + 1 < argc) replayPath = argv[++i];
+        else if(strcmp(argv[i], "--voices") == 0 && i + 1 < argc) voices = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--startup-report") == 0) startupReport = true;
+#ifdef FLAPPY_CONTROL
+        else if(strcmp(argv[i], "--control") == 0 && i + 1 < argc) controlName = argv[++i];
+        else if(strcmp(argv[i], "--lockstep") == 0) lockstep = true;
+#endif
+        else {
+            fprintf(stderr, "usage: %s [--record file | --replay file] [--voices n] [--startup-report]"
+#ifdef FLAPPY_CONTROL
+                    " [--control name [--lockstep]]"
+#endif
+                    "\n", argv[0]);
+            return 1;
+        }
+    }
+
+    Replay replay = {0};
+    ReplayCursor replayCursor = {0};
+    ReplayWriter recorder = {0};
+    bool recording = false; // this run, off once a jump couldn't be kept
+    if(replayPath && !replayOpen(&replay, replayPath)) {
+        fprintf(stderr, "can't read replay %s\n", replayPath);
+        return 1;
+    }
 
-    // Load textures    
-    Texture2D birdTexture = LoadTexture("assets/sprites/bird.png");
-    Texture2D pipeTexture = LoadTexture("assets/sprites/pipe.png");
+#ifdef FLAPPY_CONTROL
+    Control control = {0};
+    if(controlName && !controlCreate(&control, controlName, lockstep)) {
+        fprintf(stderr, "can't create shared memory /%s\n", controlName);
+        return 1;
+    }
+#else
+    (void)controlName;
+    (void)lockstep;
+#endif
 
-    Texture2D background = LoadTexture("assets/parallax/moon_back.png");
-    Texture2D midground = LoadTexture("assets/parallax/moon_mid.png");
-    Texture2D foreground = LoadTexture("assets/parallax/moon_front.png");
+    // Assets sit next to the executable (assets.pak, or loose in assets/
+    // for cross builds), wherever it's started from
+    Pak pak;
+    pakOpen(&pak, GetApplicationDirectory());
 
-    Texture2D gameOverImg = LoadTexture("assets/sprites/gameOver.png");
+    // Create a window
+    InitWindow(screenWidth,screenHeight,"FLAPPY-BIRD");
 
-    // Load sounds
+    // Textures are decoded on worker threads while the window shows a
+    // loading screen, the main thread only uploads them. The sprites
+    // come from the atlas built by atlasPack, the parallax layers are
+    // baked to the screen height (as .dds with ASSET_COMPRESS).
+    int atlasImage = loaderAddTexture(&loader, &pak, "sprites/atlas.png");
+    int layerImages[3] = {
+        loaderAddTexture(&loader, &pak, "parallax/moon_back.png"),
+        loaderAddTexture(&loader, &pak, "parallax/moon_mid.png"),
+        loaderAddTexture(&loader, &pak, "parallax/moon_front.png")
+    };
+    loaderStart(&loader, 0);
+    drawLoading(screenWidth, screenHeight, 0.0f);
+    loaderMark(&loader, "first frame");
+
+    // Load sounds, the audio device opens while the workers decode
     InitAudioDevice();
 
-    Music bgMusic = LoadMusicStream("assets/sound/bgSound/bg.mp3");
-    bgMusic.looping = true;
-    
-    SetMusicVolume(bgMusic, 0.075f);
-    PlayMusicStream(bgMusic);
+    // sound effects are mixed on the audio thread, every sample is decoded once
+    if(!mixerInit(voices)) TraceLog(LOG_WARNING, "MIXER: no audio stream, sound effects are off");
+    // baked at build time, the wavs are only read for sounds it doesn't
+    // have. From the archive the bank is mixed straight from the mapping.
+    PakEntry bank;
+    if(pakFind(&pak, "sound/sounds.bank", &bank)) mixerLoadBankMemory(bank.data, bank.size);
+    else mixerLoadBank(pakPath(&pak, "sound/sounds.bank"));
+
+    // music streams on its own thread, tracks are baked from bgSound/*.mp3.
+    // Missing tracks are -1 and cost nothing. Without a menu track the game
+    // track plays on the menu too.
+    musicInit();
+    musicSetVolume(0.075f);
+    int gameMusic = loadTrack(&pak, "sound/bgSound/bg.bank");
+    int menuMusic = loadTrack(&pak, "sound/bgSound/menu.bank");
+    if(menuMusic < 0) menuMusic = gameMusic;
+    musicPlay(replayPath ? gameMusic : menuMusic, 0.0f);
 
     // jump sounds
-    Sound jumpSounds[6][SOUND_INSTANCES];
+    const char *soundFilePath[6] = {
+        "sound/jumpSounds/bamba.wav",
+        "sound/jumpSounds/bumba.wav",
+        "sound/jumpSounds/dumba.wav",
+        "sound/jumpSounds/humba.wav",
+        "sound/jumpSounds/kamba.wav",
+        "sound/jumpSounds/ramba.wav"
+    };
+    // the bank has them, wavs it doesn't have are decoded with the textures
+    int jumpSounds[6], jumpWaves[6];
     for(int i = 0; i < 6; ++i) {
-        const char *soundFilePath[6] = {
-            "assets/sound/jumpSounds/bamba.wav",
-            "assets/sound/jumpSounds/bumba.wav",
-            "assets/sound/jumpSounds/dumba.wav",
-            "assets/sound/jumpSounds/humba.wav",
-            "assets/sound/jumpSounds/kamba.wav",
-            "assets/sound/jumpSounds/ramba.wav"
-        };
+        jumpSounds[i] = mixerFind(pakPath(&pak, soundFilePath[i]));
+        jumpWaves[i] = jumpSounds[i] < 0 ? loaderAddWave(&loader, &pak, soundFilePath[i]) : -1;
+    }
 
-        for(int j = 0; j < SOUND_INSTANCES; ++j) {
-            jumpSounds[i][j] = LoadSound(soundFilePath[i]);
-            SetSoundVolume(jumpSounds[i][j], 1.0f);
-        }
+    // a few uploads per frame until everything is in
+    while(!loaderUpdate(&loader, 0.004) && !WindowShouldClose()) {
+        drawLoading(screenWidth, screenHeight, loaderProgress(&loader));
     }
+    loaderFinish(&loader);
+    loaderMark(&loader, "assets loaded");
 
-    int currentSound = 0;
+    for(int i = 0; i < 6; ++i) {
+        if(jumpWaves[i] >= 0) jumpSounds[i] = mixerAddWave(loaderTakeWave(&loader, jumpWaves[i]));
+    }
+
+    const char *spriteNames[] = {"bird", "pipe"};
+    Atlas atlas;
+    atlasLoadWith(&atlas, &pak, "sprites", spriteNames, 2, loaderTexture(&loader, atlasImage));
+    Sprite birdSprite = atlasSprite(&atlas, "bird");
+    Sprite pipeSprite = atlasSprite(&atlas, "pipe");
+
+    Texture2D background = loaderTexture(&loader, layerImages[0]);
+    Texture2D midground = loaderTexture(&loader, layerImages[1]);
+    Texture2D foreground = loaderTexture(&loader, layerImages[2]);
 
-    // Game over sound
-    Sound gameOverSound = LoadSound("assets/sound/gameOver/gameOver.wav");
-    SetSoundVolume(gameOverSound, 1.0f);
+    SpriteBatch sprites = {0};
+
+    GameOver gameOver = {.sound = -1};
 
     float scrollingBack= 0.0f;
     float scrollingMid = 0.0f;
@@ -73,270 +253,336 @@ int main(void) {
 
     // game started
     bool gameStarted = false;
-    bool gameOver = false;
-    bool gameOverSoundPlayed = false;
-
-    // for the start menu
-    Vector2 txtPos = centerText("Press ENTER to START", 40, screenWidth, screenHeight);
-
-    // For our bird
-    Vector2 bird = {screenWidth/2.0, screenHeight/2.0-100};
-    float birdVel = 0.0f; // Y velocity of bird
 
-    // For pipes
-    float pipeWidth = 120.0f;
-    float gapSize = 250.0f;
-    float pipeSpeed = 200.0f;
-    float pipeSpacing = 320.0f;
+    // UI text is laid out once, the score only when it changes
+    CachedText startText, restartText, hintText, scoreText;
+    textCacheInit(&startText, 40, "Press ENTER to START");
+    textCacheInit(&restartText, 30, "RESTART");
+    textCacheInit(&hintText, 20, "Press R or Click Button");
+    textCacheInit(&scoreText, 60, "0");
+
+    // Bird, pipes and score live in the headless simulation
+    SimConfig simConfig = simDefaultConfig();
+    simConfig.screenWidth = screenWidth;
+    simConfig.screenHeight = screenHeight;
+    // the untrimmed frame, trimming doesn't change the hitbox
+    simConfig.birdWidth = birdSprite.size.x;
+    simConfig.birdHeight = birdSprite.size.y;
+
+    // pixel collision, the bird and pipe masks come from the atlas as uploaded
+    SimMask birdMask = {0}, pipeMask = {0};
+    Image pixels = LoadImageFromTexture(birdSprite.texture);
+    Image pipePixels = pipeSprite.texture.id == birdSprite.texture.id ? pixels : LoadImageFromTexture(pipeSprite.texture);
+    if(spriteMask(pixels, birdSprite, simConfig.birdWidth, &birdMask) &&
+       spriteMask(pipePixels, pipeSprite, simConfig.pipeWidth, &pipeMask)) {
+        simConfig.birdMask = &birdMask;
+        simConfig.pipeMask = &pipeMask;
+    } else {
+        TraceLog(LOG_WARNING, "MASK: can't read the sprites back, colliding with the hit box");
+    }
+    if(pipePixels.data != pixels.data) UnloadImage(pipePixels);
+    UnloadImage(pixels);
+
+    // replays know if they had masks, not which, so they get ours. Without
+    // them the hit box would play a different game.
+    int status = 0;
+    if(replayPath && (replay.flags & REPLAY_PIXEL_COLLISION)) {
+        if(simConfig.birdMask == NULL) {
+            TraceLog(LOG_ERROR, "REPLAY: %s needs pixel collision, the masks couldn't be built", replayPath);
+            status = 1;
+        }
+        replay.config.birdMask = simConfig.birdMask;
+        replay.config.pipeMask = simConfig.pipeMask;
+    }
 
-    float pipeX[MAX_PIPES]; // Pipe X positions
-    float gapY[MAX_PIPES]; // Gap Y positions
+    SimWorld world;
+    simInit(&world, &simConfig, randomSeed());
 
-    // pipe initialization
-    for(int i = 0; i < MAX_PIPES; ++i) {
-        pipeX[i] = screenWidth+i*pipeSpacing;
-        gapY[i] = GetRandomValue(gapSize, screenHeight-gapSize);
+    if(replayPath) {
+        replayStart(&replay, &world, &replayCursor);
+        gameStarted = true;
     }
+#ifdef FLAPPY_CONTROL
+    if(control.shared) controlPublish(&control, &world, gameStarted);
+#endif
+
+    // Physics runs at SIM_TICK_RATE, drawing blends the last two ticks
+    SimClock simClock = {0};
+    SimWorld prevWorld = world;
+    SimWorld view = world;
+    bool jumpQueued = false;
 
-    // Scores
-    int score = 0;
-    bool scored[MAX_PIPES] = {false};
+    const float pipeWidth = simConfig.pipeWidth;
+    const float gapSize = simConfig.gapSize;
 
     // Color for bird
     float colorTimer = 0.0f;
 
-    // Calulate the scale to fit 
-    float bgScale = (float)screenHeight / background.height;
-    float mgScale = (float)screenHeight / midground.height;
-    float fgScale = (float)screenHeight / foreground.height;
+    // all three layers in one shader pass, scaled to fit the height
+    Parallax parallax;
+    parallaxInit(&parallax, (Texture2D[]){background, midground, foreground}, GetColor(0x052c46ff), screenWidth, screenHeight);
 
     // Restart button
     Rectangle restartBtn = {screenWidth/2-100, screenHeight/2+100, 200, 60};
 
     // Game loop
-    while(!WindowShouldClose()) {
+    while(status == 0 && !WindowShouldClose()) {
+        PROFILE_FRAME_BEGIN();
 
-        UpdateMusicStream(bgMusic);
+        PROFILE_BEGIN(PROFILE_INPUT);
         Vector2 mousePos = GetMousePosition();
+        float frameTime = GetFrameTime();
+        PROFILE_HANDLE_KEYS();
+
+        if(gameStarted) gameOverQueue(&gameOver, &pak);
+        gameOverUpdate(&gameOver, false);
+
+        if(replayPath) {
+            // left -> back 5 seconds, hold right -> 8x speed
+            if(IsKeyPressed(KEY_LEFT)) {
+                uint32_t back = 5*SIM_TICK_RATE;
+                replaySeek(&replay, world.tick > back ? world.tick - back : 0, &world, &replayCursor);
+                prevWorld = world;
+            }
+        }
+        PROFILE_END(PROFILE_INPUT);
 
+        PROFILE_BEGIN(PROFILE_UPDATE);
         // run if gameStarted == true
-        if(gameStarted && !gameOver) {
-            // for bird gavity
-            birdVel += GRAVITY*GetFrameTime();
-            bird.y += birdVel*GetFrameTime();
-
-            // for pipe
-            for(int i = 0; i < MAX_PIPES; ++i) {
-                pipeX[i] -= pipeSpeed*GetFrameTime();
-
-                if(pipeX[i] + pipeWidth <= 0) {
-                    pipeX[i] = screenWidth;
-                    gapY[i] = GetRandomValue(gapSize/2 + 30, screenHeight-gapSize/2 - 30);
-                    scored[i] = false;
+        if(gameStarted && !world.gameOver) {
+            // space -> jump, held until the next tick picks it up
+            if(IsKeyPressed(KEY_SPACE) && !replayPath) jumpQueued = true;
+
+            float simTime = frameTime;
+            if(replayPath && IsKeyDown(KEY_RIGHT)) simTime *= 8.0f;
+
+            int events = 0;
+            int ticks = simClockAdvance(&simClock, simTime);
+#ifdef FLAPPY_CONTROL
+            // in lockstep the agent sets the pace, as many ticks as it answers in a frame
+            double frameEnd = GetTime() + 1.0/60;
+            if(control.shared && control.lockstep) ticks = INT_MAX;
+#endif
+            for(int t = 0; t < ticks && !world.gameOver; ++t) {
+                bool jump = replayPath ? replayJumpAt(&replay, &replayCursor, world.tick) : jumpQueued;
+#ifdef FLAPPY_CONTROL
+                if(control.shared) {
+                    int action = 0;
+                    double wait = control.lockstep ? frameEnd - GetTime() : 0.0;
+                    if(!controlTakeAction(&control, wait, &action) && control.lockstep) break;
+                    jump = jump || (action & CONTROL_JUMP);
+                }
+#endif
+                if(recording && jump && !replayWriterJump(&recorder, &world)) {
+                    // without the jump it would play back as another game
+                    TraceLog(LOG_WARNING, "out of memory, not recording this run");
+                    recording = false;
                 }
+
+                prevWorld = world;
+                events |= simStep(&world, (SimInput){jump}, SIM_TICK_DT);
+                jumpQueued = false;
+#ifdef FLAPPY_CONTROL
+                if(control.shared) controlPublish(&control, &world, !world.gameOver);
+#endif
+            }
+#ifdef FLAPPY_CONTROL
+            // the clock doesn't count in lockstep, draw the newest tick
+            if(control.shared && control.lockstep) {
+                prevWorld = world;
+                simClock.accumulator = 0.0f;
             }
+#endif
 
-            // Check collision within the pipe
-            float shrink = 0.3f;
-            Rectangle birdColRect = {
-                bird.x - (birdTexture.width*shrink)/2, 
-                bird.y - (birdTexture.height*shrink)/2, 
-                birdTexture.width*shrink, 
-                birdTexture.height*shrink
-            };
-
-            for(int i = 0; i < MAX_PIPES; ++i) {
-                Rectangle topPipe = {pipeX[i], 0, pipeWidth, gapY[i] - gapSize/2};
-                Rectangle bottomPipe = {pipeX[i], gapY[i] + gapSize/2, pipeWidth, screenHeight - (gapY[i] + gapSize/2)};
-
-                if(CheckCollisionRecs(birdColRect,topPipe) || CheckCollisionRecs(birdColRect, bottomPipe)) {
-                    gameOver = true;
-                    if(!gameOverSoundPlayed) {
-                        PlaySound(gameOverSound);
-                        gameOverSoundPlayed = true;
-                    }
+            if((events & SIM_EVENT_DEATH) && recording) {
+                if(!replayWriterSave(&recorder, recordPath, &world)) {
+                    TraceLog(LOG_WARNING, "can't write replay %s", recordPath);
                 }
             }
 
-            // score logic
-            for(int i = 0; i < MAX_PIPES; ++i) {
-                if(bird.x > pipeX[i] + pipeWidth && !scored[i]) {
-                    ++score;
-                    scored[i] = true;
-                }
+            PROFILE_BEGIN(PROFILE_AUDIO);
+            if(events & SIM_EVENT_JUMP) {
+                // pick random index
+                int randIdx = GetRandomValue(0, 5);
+                mixerPlay(jumpSounds[randIdx], 1.0f);
             }
 
-            // collision of top and bottom of our screen
-            if(bird.y + birdTexture.height/2 >= screenHeight || bird.y - birdTexture.height/2 <= 0) {
-                gameOver = true;
-                if(!gameOverSoundPlayed) {
-                    PlaySound(gameOverSound);
-                    gameOverSoundPlayed = true;
-                }
+            if(events & SIM_EVENT_DEATH) {
+                // decoded by now unless the run was very short
+                gameOverUpdate(&gameOver, true);
+                mixerPlay(gameOver.sound, 1.0f);
             }
+            PROFILE_END(PROFILE_AUDIO);
 
             // parallax?
-            float dt = GetFrameTime();
-            scrollingBack -= 20.0f*dt;
-            scrollingMid -= 100.0f*dt;
-            scrollingFore -= 200.0f*dt;
-
-            if(scrollingBack <= -background.width*bgScale) scrollingBack = 0;
-            if(scrollingMid <= -midground.width*mgScale) scrollingMid = 0;
-            if(scrollingFore <= -foreground.width*fgScale) scrollingFore = 0;
+            scrollingBack -= 20.0f*frameTime;
+            scrollingMid -= 100.0f*frameTime;
+            scrollingFore -= 200.0f*frameTime;
+
+            if(scrollingBack <= -parallaxLayerWidth(&parallax, 0)) scrollingBack = 0;
+            if(scrollingMid <= -parallaxLayerWidth(&parallax, 1)) scrollingMid = 0;
+            if(scrollingFore <= -parallaxLayerWidth(&parallax, 2)) scrollingFore = 0;
         }
 
         // bird alien colour
-        colorTimer += GetFrameTime() * 5.0f;
+        colorTimer += frameTime * 5.0f;
         Color birdAlien = {
             (unsigned char) (127 + 127*sinf(colorTimer)),
             (unsigned char) (127 + 127*sinf(colorTimer + 2.0f)),
             (unsigned char) (127 + 127*sinf(colorTimer + 4.0f)),
             255
         };
-        
-        // space -> jump
-        if(IsKeyPressed(KEY_SPACE) && gameStarted && !gameOver) {
-            birdVel = JUMP_FORCE;
-
-            // pick random index
-            int randIdx = GetRandomValue(0, 5);
-            PlaySound(jumpSounds[randIdx][currentSound]);
-            currentSound = (currentSound+1)%SOUND_INSTANCES;
+        PROFILE_END(PROFILE_UPDATE);
+
+        PROFILE_BEGIN(PROFILE_INPUT);
+        // between runs the agent's answer can stand in for enter and r
+        bool agentRestart = false;
+#ifdef FLAPPY_CONTROL
+        int agentAction = 0;
+        if(control.shared && (!gameStarted || world.gameOver) && controlTakeAction(&control, 0.0, &agentAction)) {
+            agentRestart = agentAction & CONTROL_RESTART;
         }
+#endif
 
         // enter -> game start
-        if(IsKeyPressed(KEY_ENTER)) gameStarted = true;
+        if((IsKeyPressed(KEY_ENTER) || agentRestart) && !gameStarted) {
+            gameStarted = true;
+            musicPlay(gameMusic, 1.0f);
+            if(recordPath) {
+                replayWriterBegin(&recorder, &world);
+                recording = true;
+            }
+#ifdef FLAPPY_CONTROL
+            if(control.shared) controlPublish(&control, &world, true);
+#endif
+        }
 
         // r -> restart
-        if(gameOver && IsKeyPressed(KEY_R) || (CheckCollisionPointRec(mousePos, restartBtn) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON))) {
+        if(world.gameOver && (IsKeyPressed(KEY_R) || agentRestart) || (CheckCollisionPointRec(mousePos, restartBtn) && IsMouseButtonPressed(MOUSE_LEFT_BUTTON))) {
 
-            if(IsSoundPlaying(gameOverSound)) {
-                StopSound(gameOverSound);
-            }
+            mixerStop(gameOver.sound);
 
-            gameOver = false;
             gameStarted = false;
-            gameOverSoundPlayed = false;
-            bird.y =  screenHeight/2-100;
-            birdVel = 0;
-            score = 0;
             scrollingBack = 0.0f;
             scrollingMid = 0.0f;
             scrollingFore = 0.0f;
 
-            // reset pipes
-            for(int i = 0; i < MAX_PIPES; ++i) {
-                pipeX[i] = screenWidth+i*pipeSpacing;
-                gapY[i] = GetRandomValue(gapSize, screenHeight-gapSize);
-                scored[i] = false;
+            // reset bird, pipes and score
+            if(replayPath) {
+                replayStart(&replay, &world, &replayCursor);
+                gameStarted = true;
+            } else {
+                simReset(&world, randomSeed());
+                musicPlay(menuMusic, 1.0f);
             }
+            prevWorld = world;
+            simClock.accumulator = 0.0f;
+            jumpQueued = false;
+#ifdef FLAPPY_CONTROL
+            if(control.shared) controlPublish(&control, &world, gameStarted);
+#endif
         }
+        PROFILE_END(PROFILE_INPUT);
+
+        // no blending once dead, the last tick is where the bird hit
+        if(world.gameOver) view = world;
+        else simInterpolate(&prevWorld, &world, simClockAlpha(&simClock), &view);
 
         /* Draw */
+        PROFILE_BEGIN(PROFILE_DRAW);
         BeginDrawing();
-            ClearBackground(GetColor(0x052c46ff));
-            // Background
-            DrawTextureEx(background, (Vector2){scrollingBack, 0}, 0.0f, bgScale, WHITE);
-            DrawTextureEx(background, (Vector2){scrollingBack + background.width*bgScale, 0}, 0.0f, bgScale, WHITE);
-
-            // Midground  
-            DrawTextureEx(midground, (Vector2){scrollingMid, 0}, 0.0f, mgScale, WHITE);
-            DrawTextureEx(midground, (Vector2){scrollingMid + midground.width*mgScale, 0}, 0.0f, mgScale, WHITE);
-
-            // Foreground
-            DrawTextureEx(foreground, (Vector2){scrollingFore, 0}, 0.0f, fgScale, WHITE);
-            DrawTextureEx(foreground, (Vector2){scrollingFore + foreground.width*fgScale, 0}, 0.0f, fgScale, WHITE);
-            DrawTexture(birdTexture, bird.x - birdTexture.width/2, bird.y - birdTexture.height/2, birdAlien);
+            spriteBatchBegin(&sprites);
+            // Background, midground and foreground
+            parallaxDraw(&parallax, (float[]){scrollingBack, scrollingMid, scrollingFore}, &sprites, LAYER_BACKGROUND);
+
+            float birdWidth = birdSprite.size.x, birdHeight = birdSprite.size.y;
+            spriteBatchDraw(&sprites, LAYER_BIRD, birdSprite, (Rectangle){(int)(view.birdX - birdWidth/2), (int)(view.birdY - birdHeight/2), birdWidth, birdHeight}, birdAlien);
             if(gameStarted) {
-                for(int i = 0; i < MAX_PIPES; ++i) {
+                // only what's on screen
+                uint32_t first;
+                uint32_t visible = simPipesInSpan(&view, 0, screenWidth, &first);
+                for(uint32_t k = first; k < first + visible; ++k) {
+                    uint32_t i = simPipeSlot(&view, k);
                     // Top pipe
-                    DrawTexturePro(
-                        pipeTexture,
-                        (Rectangle){0,0,pipeTexture.width, pipeTexture.height},
-                        (Rectangle){pipeX[i], 0, pipeWidth, gapY[i] - gapSize/2},
-                        (Vector2){0,0},
-                        0,
-                        WHITE
-                    );
+                    spriteBatchDraw(&sprites, LAYER_PIPES, pipeSprite,
+                        (Rectangle){view.pipeX[i], 0, pipeWidth, view.gapY[i] - gapSize/2}, WHITE);
                     // Bottom pipe
-                    DrawTexturePro(
-                        pipeTexture,
-                        (Rectangle){0,0,pipeTexture.width, pipeTexture.height},
-                        (Rectangle){pipeX[i], gapY[i] + gapSize/2, pipeWidth, screenHeight - (gapY[i] + gapSize/2)},
-                        (Vector2){0,0},
-                        0,
-                        WHITE
-                    );
+                    spriteBatchDraw(&sprites, LAYER_PIPES, pipeSprite,
+                        (Rectangle){view.pipeX[i], view.gapY[i] + gapSize/2, pipeWidth, screenHeight - (view.gapY[i] + gapSize/2)}, WHITE);
                 }
+            }
+            // bird and pipes share the atlas, so they go out together
+            spriteBatchEnd(&sprites);
 
-                if(gameOver) {
+            if(gameStarted) {
+                if(view.gameOver) {
                     // Draw semi-transparent dark rectangle
                     DrawRectangle(0,0,screenWidth,screenHeight, (Color){0,0,0,180});
 
                     // Draw game over image
-                    int imgX = screenWidth/2 - gameOverImg.width/2;
-                    int imgY = screenHeight/2 - gameOverImg.height/2;
-
-                    DrawTexture(gameOverImg, imgX, imgY, birdAlien);
+                    Rectangle img = {0, 0, gameOver.sprite.size.x, gameOver.sprite.size.y};
+                    img.x = screenWidth/2 - (int)img.width/2;
+                    img.y = screenHeight/2 - (int)img.height/2;
 
-                    // score draw ig
-                    char scoreTxt[50];
-                    sprintf(scoreTxt, "Score: %d", score);
-                    int scoreWidth = MeasureText(scoreTxt, 40);
+                    BeginBlendMode(SPRITE_BLEND_MODE);
+                        spriteDraw(gameOver.sprite, img, birdAlien);
+                    EndBlendMode();
 
                     // restart btn
                     Color btnColor = CheckCollisionPointRec(mousePos, restartBtn) ? DARKGREEN : GREEN;
                     DrawRectangleRec(restartBtn, btnColor);
                     DrawRectangleLinesEx(restartBtn, 3, WHITE);
 
-                    const char *buttonTxt = "RESTART";
-                    int btnTextWidth = MeasureText(buttonTxt, 30);
-                    DrawText(
-                        buttonTxt,
-                        restartBtn.x + restartBtn.width/2 - btnTextWidth/2,
-                        restartBtn.y + restartBtn.height/2 - 15,
-                        30,
-                        WHITE
-                    );
-
-                    const char *looseTxt = "Press R or Click Button";
-                    int looseTxtWidth = MeasureText(looseTxt, 20);
-                    DrawText(
-                        looseTxt,
-                        screenWidth/2 - looseTxtWidth/2,
-                        restartBtn.y + 80,
-                        20,
-                        LIGHTGRAY
-                    );
+                    textCacheDrawCentered(&restartText, restartBtn.x + restartBtn.width/2, restartBtn.y + restartBtn.height/2 - 15, WHITE);
+                    textCacheDrawCentered(&hintText, screenWidth/2, restartBtn.y + 80, LIGHTGRAY);
                 }
             } else {
-                DrawText("Press ENTER to START", txtPos.x, txtPos.y, 40, RAYWHITE);
+                textCacheDrawCentered(&startText, screenWidth/2, screenHeight/2 - 40/2, RAYWHITE);
             }
             if(gameStarted) {
-                char scoreTxt[20];
-                sprintf(scoreTxt, "%d", score);
-                int scoreWidth = MeasureText(scoreTxt, 60);
-                DrawText(scoreTxt, screenWidth/2-scoreWidth/2, 50, 60, birdAlien);
+                textCacheSetNumber(&scoreText, view.score);
+                textCacheDrawCentered(&scoreText, screenWidth/2, 50, birdAlien);
             }
+            if(replayPath) {
+                DrawText(TextFormat("REPLAY %.1fs / %.1fs   [LEFT] back 5s   [RIGHT] fast forward",
+                         (float)view.tick/SIM_TICK_RATE, (float)replay.endTick/SIM_TICK_RATE), 10, 10, 20, LIGHTGRAY);
+            }
+            PROFILE_DRAW_OVERLAY(screenWidth - 270, 10);
+            PROFILE_END(PROFILE_DRAW);
+
+            PROFILE_BEGIN(PROFILE_PRESENT);
         EndDrawing();
-    }
+        PROFILE_END(PROFILE_PRESENT);
 
-    UnloadMusicStream(bgMusic);
-    for(int i = 0; i < 6; ++i) {
-        for(int j = 0; j < SOUND_INSTANCES; ++j) {
-            UnloadSound(jumpSounds[i][j]);
+        // the first frame that takes input
+        if(startupReport) {
+            loaderMark(&loader, "interactive");
+            loaderReport(&loader, stdout);
+            startupReport = false;
         }
     }
-    UnloadSound(gameOverSound);
+
+    mixerClose();
+    musicClose();
     CloseAudioDevice();
-    UnloadTexture(gameOverImg);
     UnloadTexture(background);
     UnloadTexture(midground);
     UnloadTexture(foreground);
-    UnloadTexture(birdTexture);
-    UnloadTexture(pipeTexture);
+    parallaxUnload(&parallax);
+    atlasUnload(&atlas);
+    gameOverUpdate(&gameOver, true);
+    if(gameOver.sprite.texture.id) UnloadTexture(gameOver.sprite.texture);
+    spriteBatchFree(&sprites);
     CloseWindow(); // close window
+    pakClose(&pak);
+
+    replayWriterFree(&recorder);
+    replayClose(&replay);
+#ifdef FLAPPY_CONTROL
+    if(control.shared) controlClose(&control);
+#endif
+    simMaskFree(&birdMask);
+    simMaskFree(&pipeMask);
 
-    return 0;
+    return status;
 }
\ No newline at end of file
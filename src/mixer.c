@@ -0,0 +1,370 @@
+#include "mixer.h"
+
+#include <raylib.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adpcm.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MIXER_SSE2
+#endif
+
+#define RING_SIZE 256 // power of two
+#define CACHE_LINE 64
+
+enum {
+    COMMAND_PLAY,
+    COMMAND_STOP,
+    COMMAND_VOLUME
+};
+
+typedef struct Command {
+    int type;
+    int sample;
+    float volume;
+} Command;
+
+// head is only written by the game thread, tail only by the audio thread
+typedef struct CommandRing {
+    _Alignas(CACHE_LINE) _Atomic uint32_t head;
+    _Alignas(CACHE_LINE) _Atomic uint32_t tail;
+    Command commands[RING_SIZE];
+} CommandRing;
+
+typedef struct Sample {
+    char name[32];
+    uint32_t frames;
+    const int16_t *pcm; // interleaved stereo, or
+    const uint8_t *adpcm; // blocks in the bank
+    Wave wave; // owns pcm
+} Sample;
+
+typedef struct Voice {
+    int sample; // -1 if idle
+    uint32_t position;
+    float gain;
+    uint32_t started;
+
+    // decoded adpcm block the voice is in
+    uint32_t block;
+    int16_t decoded[ADPCM_BLOCK_FRAMES*ADPCM_CHANNELS];
+} Voice;
+
+static struct {
+    AudioStream stream;
+    bool ready;
+    CommandRing ring;
+
+    // written by the game thread before the sample's first command
+    Sample samples[MIXER_MAX_SAMPLES];
+    int sampleCount;
+    const uint8_t *bank;
+    uint8_t *ownedBank; // bank if mixerLoadBank read it
+    int bankCount; // the first bankCount samples
+
+    // audio thread only
+    Voice voices[MIXER_MAX_VOICES];
+    int polyphony;
+    uint32_t playCount;
+    float volume;
+
+    // voices per sample, published after every buffer
+    _Atomic int playing[MIXER_MAX_SAMPLES];
+
+    _Atomic(MixerSource) source;
+} mixer;
+
+static bool ringPush(CommandRing *ring, Command command) {
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if(head - tail == RING_SIZE) return false;
+
+    ring->commands[head & (RING_SIZE - 1)] = command;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return true;
+}
+
+static bool ringPop(CommandRing *ring, Command *command) {
+    uint32_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    if(tail == head) return false;
+
+    *command = ring->commands[tail & (RING_SIZE - 1)];
+    atomic_store_explicit(&ring->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+/* Audio thread */
+
+static void startVoice(int sample, float volume) {
+    // a free voice, or steal the oldest
+    Voice *voice = NULL;
+    for(int v = 0; v < mixer.polyphony; ++v) {
+        Voice *candidate = &mixer.voices[v];
+        if(candidate->sample < 0) {
+            voice = candidate;
+            break;
+        }
+        if(voice == NULL || candidate->started < voice->started) voice = candidate;
+    }
+
+    voice->sample = sample;
+    voice->position = 0;
+    voice->gain = volume;
+    voice->started = ++mixer.playCount;
+    voice->block = UINT32_MAX;
+}
+
+static void runCommands(void) {
+    Command command;
+    while(ringPop(&mixer.ring, &command)) {
+        switch(command.type) {
+            case COMMAND_PLAY:
+                startVoice(command.sample, command.volume);
+                break;
+            case COMMAND_STOP:
+                for(int v = 0; v < mixer.polyphony; ++v) {
+                    if(mixer.voices[v].sample == command.sample) mixer.voices[v].sample = -1;
+                }
+                break;
+            case COMMAND_VOLUME:
+                mixer.volume = command.volume;
+                break;
+        }
+    }
+}
+
+void mixerAccumulate(float *out, const int16_t *pcm, unsigned int count, float gain) {
+    const float scale = gain/32768.0f;
+    uint32_t i = 0;
+#if defined(MIXER_SSE2)
+    __m128 g = _mm_set1_ps(scale);
+    for(; i + 8 <= count; i += 8) {
+        __m128i s = _mm_loadu_si128((const __m128i *)(pcm + i));
+        // duplicate each 16-bit value into a 32-bit lane, the shift sign extends
+        __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(s, s), 16));
+        __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(s, s), 16));
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(lo, g)));
+        _mm_storeu_ps(out + i + 4, _mm_add_ps(_mm_loadu_ps(out + i + 4), _mm_mul_ps(hi, g)));
+    }
+#endif
+    for(; i < count; ++i) out[i] += pcm[i]*scale;
+}
+
+// master volume and clip to [-1, 1]
+static void finishSamples(float *out, uint32_t count, float volume) {
+    uint32_t i = 0;
+#if defined(MIXER_SSE2)
+    __m128 v = _mm_set1_ps(volume), lo = _mm_set1_ps(-1.0f), hi = _mm_set1_ps(1.0f);
+    for(; i + 4 <= count; i += 4) {
+        __m128 x = _mm_mul_ps(_mm_loadu_ps(out + i), v);
+        _mm_storeu_ps(out + i, _mm_min_ps(_mm_max_ps(x, lo), hi));
+    }
+#endif
+    for(; i < count; ++i) {
+        float x = out[i]*volume;
+        out[i] = x < -1.0f ? -1.0f : x > 1.0f ? 1.0f : x;
+    }
+}
+
+// mixes n frames from voice->position, decoding blocks as it crosses them
+static void mixAdpcm(float *out, Voice *voice, const Sample *sample, uint32_t n) {
+    uint32_t done = 0;
+    while(done < n) {
+        uint32_t position = voice->position + done;
+        uint32_t block = position/ADPCM_BLOCK_FRAMES;
+        uint32_t offset = position % ADPCM_BLOCK_FRAMES;
+        if(voice->block != block) {
+            adpcmDecodeBlock(voice->decoded, sample->adpcm + (size_t)block*ADPCM_BLOCK_BYTES);
+            voice->block = block;
+        }
+
+        uint32_t count = ADPCM_BLOCK_FRAMES - offset;
+        if(count > n - done) count = n - done;
+        mixerAccumulate(out + 2*done, voice->decoded + 2*offset, 2*count, voice->gain);
+        done += count;
+    }
+}
+
+static void mixerCallback(void *buffer, unsigned int frames) {
+    float *out = buffer;
+    runCommands();
+
+    memset(out, 0, frames*2*sizeof(float));
+
+    int playing[MIXER_MAX_SAMPLES] = {0};
+    for(int v = 0; v < mixer.polyphony; ++v) {
+        Voice *voice = &mixer.voices[v];
+        if(voice->sample < 0) continue;
+
+        const Sample *sample = &mixer.samples[voice->sample];
+        uint32_t left = sample->frames - voice->position;
+        uint32_t n = left < frames ? left : frames;
+        if(sample->adpcm) mixAdpcm(out, voice, sample, n);
+        else mixerAccumulate(out, sample->pcm + 2*voice->position, 2*n, voice->gain);
+
+        voice->position += n;
+        if(voice->position >= sample->frames) voice->sample = -1;
+        else ++playing[voice->sample];
+    }
+
+    MixerSource source = atomic_load_explicit(&mixer.source, memory_order_acquire);
+    if(source) source(out, frames);
+
+    finishSamples(out, 2*frames, mixer.volume);
+
+    for(int s = 0; s < MIXER_MAX_SAMPLES; ++s) {
+        atomic_store_explicit(&mixer.playing[s], playing[s], memory_order_relaxed);
+    }
+}
+
+/* Game thread */
+
+bool mixerInit(int polyphony) {
+    memset(&mixer, 0, sizeof(mixer));
+    if(polyphony < 1) polyphony = 1;
+    if(polyphony > MIXER_MAX_VOICES) polyphony = MIXER_MAX_VOICES;
+    mixer.polyphony = polyphony;
+    mixer.volume = 1.0f;
+    for(int v = 0; v < MIXER_MAX_VOICES; ++v) mixer.voices[v].sample = -1;
+
+    // the buffer size is what bounds play latency
+    SetAudioStreamBufferSizeDefault(MIXER_BUFFER_FRAMES);
+    mixer.stream = LoadAudioStream(MIXER_SAMPLE_RATE, 32, 2);
+    SetAudioStreamBufferSizeDefault(0);
+    if(!IsAudioStreamReady(mixer.stream)) return false;
+
+    SetAudioStreamCallback(mixer.stream, mixerCallback);
+    PlayAudioStream(mixer.stream);
+    mixer.ready = true;
+    return true;
+}
+
+void mixerClose(void) {
+    if(mixer.ready) UnloadAudioStream(mixer.stream);
+    mixer.ready = false;
+
+    for(int s = mixer.bankCount; s < mixer.sampleCount; ++s) UnloadWave(mixer.samples[s].wave);
+    mixer.sampleCount = 0;
+    free(mixer.ownedBank);
+    mixer.ownedBank = NULL;
+    mixer.bank = NULL;
+    mixer.bankCount = 0;
+}
+
+static uint32_t get32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// Points the first samples at the bank's blocks
+static bool useBank(const uint8_t *bank, size_t size, const char *what) {
+    // before any wav, so bank samples stay the first bankCount
+    if(!mixer.ready || mixer.bank || mixer.sampleCount) return false;
+
+    uint32_t count = size > MIXER_BANK_HEADER_SIZE ? get32(bank + 8) : 0;
+    bool ok = size > MIXER_BANK_HEADER_SIZE && memcmp(bank, "FBNK", 4) == 0 && get32(bank + 4) == MIXER_BANK_VERSION
+            && get32(bank + 12) == MIXER_SAMPLE_RATE && get32(bank + 16) == ADPCM_BLOCK_FRAMES
+            && count <= MIXER_MAX_SAMPLES && MIXER_BANK_HEADER_SIZE + (size_t)count*MIXER_BANK_ENTRY_SIZE <= size;
+
+    for(uint32_t i = 0; ok && i < count; ++i) {
+        const uint8_t *entry = bank + MIXER_BANK_HEADER_SIZE + i*MIXER_BANK_ENTRY_SIZE;
+        uint32_t frames = get32(entry + 32), offset = get32(entry + 36), bytes = get32(entry + 40);
+        ok = bytes == adpcmBlockCount(frames)*ADPCM_BLOCK_BYTES && offset <= size && bytes <= size - offset;
+
+        Sample *sample = &mixer.samples[i];
+        memset(sample, 0, sizeof(*sample));
+        memcpy(sample->name, entry, sizeof(sample->name) - 1);
+        sample->frames = frames;
+        sample->adpcm = bank + offset;
+    }
+
+    if(!ok) {
+        TraceLog(LOG_WARNING, "MIXER: %s isn't a usable sound bank, rebuild it", what);
+        return false;
+    }
+
+    mixer.bank = bank;
+    mixer.bankCount = mixer.sampleCount = (int)count;
+    return true;
+}
+
+bool mixerLoadBank(const char *path) {
+    if(!mixer.ready || mixer.bank || mixer.sampleCount) return false;
+
+    FILE *file = fopen(path, "rb");
+    if(file == NULL) return false;
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *bank = size > MIXER_BANK_HEADER_SIZE ? malloc(size) : NULL;
+    bool ok = bank && fread(bank, 1, size, file) == (size_t)size;
+    fclose(file);
+
+    if(!ok || !useBank(bank, size, path)) {
+        free(bank);
+        return false;
+    }
+    mixer.ownedBank = bank;
+    return true;
+}
+
+bool mixerLoadBankMemory(const void *data, size_t size) {
+    return useBank(data, size, "bank in memory");
+}
+
+int mixerFind(const char *path) {
+    const char *name = GetFileNameWithoutExt(path);
+    for(int s = 0; s < mixer.bankCount; ++s) {
+        if(strcmp(mixer.samples[s].name, name) == 0) return s;
+    }
+    return -1;
+}
+
+int mixerAddWave(Wave wave) {
+    if(!mixer.ready || mixer.sampleCount == MIXER_MAX_SAMPLES || wave.data == NULL || wave.frameCount == 0) {
+        UnloadWave(wave);
+        return -1;
+    }
+    WaveFormat(&wave, MIXER_SAMPLE_RATE, 16, 2);
+
+    int s = mixer.sampleCount++;
+    mixer.samples[s] = (Sample){.frames = wave.frameCount, .pcm = wave.data, .wave = wave};
+    return s;
+}
+
+int mixerLoad(const char *path) {
+    int s = mixerFind(path);
+    if(s >= 0) return s;
+
+    if(!mixer.ready || mixer.sampleCount == MIXER_MAX_SAMPLES) return -1;
+    return mixerAddWave(LoadWave(path));
+}
+
+bool mixerPlay(int sample, float volume) {
+    if(sample < 0 || sample >= mixer.sampleCount) return false;
+    return ringPush(&mixer.ring, (Command){COMMAND_PLAY, sample, volume});
+}
+
+bool mixerStop(int sample) {
+    if(sample < 0 || sample >= mixer.sampleCount) return false;
+    return ringPush(&mixer.ring, (Command){COMMAND_STOP, sample, 0.0f});
+}
+
+bool mixerSetVolume(float volume) {
+    if(!mixer.ready) return false;
+    return ringPush(&mixer.ring, (Command){COMMAND_VOLUME, -1, volume});
+}
+
+void mixerSetSource(MixerSource source) {
+    atomic_store_explicit(&mixer.source, source, memory_order_release);
+}
+
+bool mixerIsPlaying(int sample) {
+    if(sample < 0 || sample >= mixer.sampleCount) return false;
+    return atomic_load_explicit(&mixer.playing[sample], memory_order_relaxed) > 0;
+}
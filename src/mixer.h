@@ -0,0 +1,70 @@
+#ifndef MIXER_H
+#define MIXER_H
+
+#include <raylib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Sound effects mixed on the audio thread. The game thread never touches
+// a voice: mixerPlay/mixerStop/mixerSetVolume push a command into a
+// lock-free single-producer/single-consumer ring, and the AudioStream
+// callback drains it at the start of every buffer it fills. A sound
+// starts at most one buffer (MIXER_BUFFER_FRAMES) after it is requested,
+// however long the frame that asked for it takes.
+//
+// Sounds come from a bank baked by soundBake (IMA-ADPCM at the mixer
+// rate, decoded one block at a time while mixing) or, when a sound isn't
+// in the bank, from its wav decoded to 16-bit PCM at load. Any number of
+// voices can play the same sample. Past `polyphony` voices the oldest
+// one is cut.
+//
+// All functions are for the game thread. Call after InitAudioDevice.
+
+#define MIXER_SAMPLE_RATE 48000
+#define MIXER_BUFFER_FRAMES 512
+#define MIXER_MAX_SAMPLES 32
+#define MIXER_MAX_VOICES 32
+
+// Sound bank files, see soundBake.c for the layout
+#define MIXER_BANK_VERSION 1
+#define MIXER_BANK_HEADER_SIZE 20
+#define MIXER_BANK_ENTRY_SIZE 44
+
+bool mixerInit(int polyphony);
+void mixerClose(void);
+
+// Makes the bank's sounds available to mixerLoad, the file stays in memory
+bool mixerLoadBank(const char *path);
+// Same for a bank already in memory (mapped from the asset archive), which
+// must stay there until mixerClose
+bool mixerLoadBankMemory(const void *data, size_t size);
+
+// Index of the sample, -1 if it can't be loaded. A bank sound with the
+// same file name (without extension) is used instead of the file.
+int mixerLoad(const char *path);
+// Only the bank part of mixerLoad, -1 if the bank doesn't have it
+int mixerFind(const char *path);
+// Takes over a wave decoded elsewhere (the startup loader), -1 if it
+// can't and the wave is freed
+int mixerAddWave(Wave wave);
+
+// false if the command ring is full, the command is dropped
+bool mixerPlay(int sample, float volume);
+// Stops every voice playing sample
+bool mixerStop(int sample);
+bool mixerSetVolume(float volume);
+
+// As of the last buffer the audio thread mixed
+bool mixerIsPlaying(int sample);
+
+// Called on the audio thread for every buffer, after the voices, to add
+// frames of interleaved stereo into out. It must not block or allocate.
+// Stays installed until mixerClose returns.
+typedef void (*MixerSource)(float *out, unsigned int frames);
+void mixerSetSource(MixerSource source);
+
+// out[i] += pcm[i]*gain for count interleaved values, for sources
+void mixerAccumulate(float *out, const int16_t *pcm, unsigned int count, float gain);
+
+#endif
@@ -0,0 +1,372 @@
+#include "music.h"
+
+#include <pthread.h>
+#include <raylib.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "adpcm.h"
+#include "mixer.h"
+
+#define CHUNK_FRAMES ADPCM_BLOCK_FRAMES // the ring size is a multiple of this
+#define CACHE_LINE 64
+#define DECLICK_STEP (1.0f/(0.005f*MIXER_SAMPLE_RATE)) // the quickest fade out, 5 ms
+
+typedef struct Track {
+    char path[256];
+    const uint8_t *data; // the whole bank when it's in memory, else read from path
+    uint32_t offset; // of the first block
+    uint32_t frames;
+} Track;
+
+// One playing track, two of them crossfade
+typedef struct Deck {
+    int track; // -1 if idle
+    FILE *file;
+    uint32_t position; // next frame
+    uint32_t nextBlock; // where the file is
+    uint32_t decoded; // block held in pcm, UINT32_MAX if none
+    int16_t pcm[ADPCM_BLOCK_FRAMES*ADPCM_CHANNELS];
+    float gain, target, step; // step per frame
+} Deck;
+
+static struct {
+    Track tracks[MUSIC_MAX_TRACKS];
+    int trackCount;
+
+    // decoded frames, written by the music thread, read by the audio thread
+    int16_t ring[MUSIC_RING_FRAMES*2];
+    _Alignas(CACHE_LINE) _Atomic uint32_t writePos;
+    _Alignas(CACHE_LINE) _Atomic uint32_t readPos;
+
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    bool started;
+
+    // under lock
+    bool running;
+    bool pending;
+    int pendingTrack;
+    float pendingFade;
+    float volume;
+
+    // music thread only
+    Deck decks[2];
+    int current; // the deck fading in or playing
+} music;
+
+static uint32_t get32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/* Audio thread */
+
+static void musicSource(float *out, unsigned int frames) {
+    uint32_t read = atomic_load_explicit(&music.readPos, memory_order_relaxed);
+    uint32_t write = atomic_load_explicit(&music.writePos, memory_order_acquire);
+    uint32_t n = write - read;
+    if(n > frames) n = frames;
+    if(n == 0) return;
+
+    uint32_t start = read % MUSIC_RING_FRAMES;
+    uint32_t first = MUSIC_RING_FRAMES - start;
+    if(first > n) first = n;
+    mixerAccumulate(out, music.ring + 2*start, 2*first, 1.0f);
+    mixerAccumulate(out + 2*first, music.ring, 2*(n - first), 1.0f);
+
+    atomic_store_explicit(&music.readPos, read + n, memory_order_release);
+}
+
+/* Music thread */
+
+static void deckClose(Deck *deck) {
+    if(deck->file) fclose(deck->file);
+    deck->file = NULL;
+    deck->track = -1;
+    deck->gain = deck->target = 0.0f;
+}
+
+static bool deckOpen(Deck *deck, int track) {
+    deckClose(deck);
+    if(music.tracks[track].data == NULL) {
+        deck->file = fopen(music.tracks[track].path, "rb");
+        if(deck->file == NULL) return false;
+    }
+
+    deck->track = track;
+    deck->position = 0;
+    deck->nextBlock = UINT32_MAX;
+    deck->decoded = UINT32_MAX;
+    return true;
+}
+
+// Fills out with frames of the deck's track, looping at the end. Returns
+// fewer on a read error.
+static uint32_t deckRead(Deck *deck, int16_t *out, uint32_t frames) {
+    const Track *track = &music.tracks[deck->track];
+    uint32_t done = 0;
+    while(done < frames) {
+        if(deck->position >= track->frames) deck->position = 0;
+
+        uint32_t block = deck->position/ADPCM_BLOCK_FRAMES;
+        uint32_t offset = deck->position % ADPCM_BLOCK_FRAMES;
+        if(deck->decoded != block && track->data) {
+            adpcmDecodeBlock(deck->pcm, track->data + track->offset + (size_t)block*ADPCM_BLOCK_BYTES);
+            deck->decoded = block;
+        } else if(deck->decoded != block) {
+            if(deck->nextBlock != block &&
+               fseek(deck->file, track->offset + (long)block*ADPCM_BLOCK_BYTES, SEEK_SET) != 0) break;
+
+            uint8_t data[ADPCM_BLOCK_BYTES];
+            if(fread(data, 1, sizeof(data), deck->file) != sizeof(data)) break;
+            adpcmDecodeBlock(deck->pcm, data);
+            deck->decoded = block;
+            deck->nextBlock = block + 1;
+        }
+
+        uint32_t count = ADPCM_BLOCK_FRAMES - offset;
+        if(count > track->frames - deck->position) count = track->frames - deck->position;
+        if(count > frames - done) count = frames - done;
+        memcpy(out + 2*done, deck->pcm + 2*offset, count*2*sizeof(int16_t));
+        deck->position += count;
+        done += count;
+    }
+    return done;
+}
+
+static void fadeTo(Deck *deck, float target, float step) {
+    deck->target = target;
+    deck->step = step;
+}
+
+// Returns false while the track waits for a deck to go idle, call it again
+static bool switchTrack(int track, float fade) {
+    float step = fade > 0.0f ? 1.0f/(fade*MIXER_SAMPLE_RATE) : 1.0f;
+    Deck *current = &music.decks[music.current];
+    Deck *other = &music.decks[1 - music.current];
+
+    if(track >= 0 && other->track == track) {
+        // coming back to the track that is fading out, fade it back in
+        music.current = 1 - music.current;
+        fadeTo(other, 1.0f, step);
+        fadeTo(current, 0.0f, step);
+        return true;
+    }
+    if(track >= 0 && current->track == track) {
+        fadeTo(current, 1.0f, step);
+        fadeTo(other, 0.0f, step);
+        return true;
+    }
+    if(track < 0) {
+        fadeTo(current, 0.0f, step);
+        fadeTo(other, 0.0f, step);
+        return true;
+    }
+
+    // the new track goes on an idle deck
+    int next = other->track < 0 || current->track >= 0 ? 1 - music.current : music.current;
+    Deck *deck = &music.decks[next];
+    Deck *old = &music.decks[1 - next];
+    if(deck->track >= 0) {
+        // A third track while both play, opening one of them would cut it
+        // off and click. The quieter one fades out in a few ms first.
+        if(deck->gain > old->gain) {
+            next = 1 - next;
+            deck = &music.decks[next];
+            old = &music.decks[1 - next];
+        }
+        fadeTo(old, 0.0f, step);
+        fadeTo(deck, 0.0f, step > DECLICK_STEP ? step : DECLICK_STEP);
+        music.current = 1 - next;
+        return false;
+    }
+
+    fadeTo(old, 0.0f, step);
+    if(deckOpen(deck, track)) {
+        deck->gain = 0.0f;
+        fadeTo(deck, 1.0f, step);
+        music.current = next;
+    }
+    return true;
+}
+
+// One chunk of both decks, faded and mixed into the ring
+static void produce(float volume) {
+    float mix[CHUNK_FRAMES*2] = {0};
+    int16_t pcm[CHUNK_FRAMES*2];
+
+    for(int d = 0; d < 2; ++d) {
+        Deck *deck = &music.decks[d];
+        if(deck->track < 0) continue;
+
+        uint32_t got = deckRead(deck, pcm, CHUNK_FRAMES);
+        for(uint32_t i = 0; i < got; ++i) {
+            float g = deck->gain*volume;
+            mix[2*i] += pcm[2*i]*g;
+            mix[2*i + 1] += pcm[2*i + 1]*g;
+
+            if(deck->gain < deck->target) {
+                deck->gain += deck->step;
+                if(deck->gain > deck->target) deck->gain = deck->target;
+            } else if(deck->gain > deck->target) {
+                deck->gain -= deck->step;
+                if(deck->gain < deck->target) deck->gain = deck->target;
+            }
+        }
+
+        if(got < CHUNK_FRAMES) {
+            TraceLog(LOG_WARNING, "MUSIC: can't read %s", music.tracks[deck->track].path);
+            deckClose(deck);
+        } else if(deck->gain == 0.0f && deck->target == 0.0f) {
+            deckClose(deck);
+        }
+    }
+
+    uint32_t write = atomic_load_explicit(&music.writePos, memory_order_relaxed);
+    int16_t *out = music.ring + 2*(write % MUSIC_RING_FRAMES);
+    for(int i = 0; i < CHUNK_FRAMES*2; ++i) {
+        float x = mix[i];
+        out[i] = (int16_t)(x < -32768.0f ? -32768.0f : x > 32767.0f ? 32767.0f : x);
+    }
+    atomic_store_explicit(&music.writePos, write + CHUNK_FRAMES, memory_order_release);
+}
+
+static void *musicThread(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&music.lock);
+    while(music.running) {
+        if(music.pending) {
+            // else it waits for a deck, the next chunk asks again
+            if(switchTrack(music.pendingTrack, music.pendingFade)) music.pending = false;
+        }
+
+        if(music.decks[0].track < 0 && music.decks[1].track < 0) {
+            // nothing playing, sleep until musicPlay
+            pthread_cond_wait(&music.wake, &music.lock);
+            continue;
+        }
+
+        uint32_t write = atomic_load_explicit(&music.writePos, memory_order_relaxed);
+        uint32_t read = atomic_load_explicit(&music.readPos, memory_order_acquire);
+        if(MUSIC_RING_FRAMES - (write - read) < CHUNK_FRAMES) {
+            // ring is full, check again in about half a chunk
+            struct timespec until;
+            clock_gettime(CLOCK_REALTIME, &until);
+            until.tv_nsec += 5000000;
+            if(until.tv_nsec >= 1000000000) {
+                until.tv_sec += 1;
+                until.tv_nsec -= 1000000000;
+            }
+            pthread_cond_timedwait(&music.wake, &music.lock, &until);
+            continue;
+        }
+
+        float volume = music.volume;
+        pthread_mutex_unlock(&music.lock);
+        produce(volume);
+        pthread_mutex_lock(&music.lock);
+    }
+    pthread_mutex_unlock(&music.lock);
+    return NULL;
+}
+
+/* Game thread */
+
+bool musicInit(void) {
+    memset(&music, 0, sizeof(music));
+    music.volume = 1.0f;
+    music.running = true;
+    music.decks[0].track = music.decks[1].track = -1;
+
+    pthread_mutex_init(&music.lock, NULL);
+    pthread_cond_init(&music.wake, NULL);
+    if(pthread_create(&music.thread, NULL, musicThread, NULL) != 0) {
+        pthread_cond_destroy(&music.wake);
+        pthread_mutex_destroy(&music.lock);
+        return false;
+    }
+    music.started = true;
+    mixerSetSource(musicSource);
+    return true;
+}
+
+void musicClose(void) {
+    if(!music.started) return;
+
+    pthread_mutex_lock(&music.lock);
+    music.running = false;
+    pthread_cond_signal(&music.wake);
+    pthread_mutex_unlock(&music.lock);
+    pthread_join(music.thread, NULL);
+
+    for(int d = 0; d < 2; ++d) deckClose(&music.decks[d]);
+    pthread_cond_destroy(&music.wake);
+    pthread_mutex_destroy(&music.lock);
+    music.started = false;
+}
+
+// Checks a bank header and its first entry, size is the whole bank
+static int addTrack(const uint8_t *header, size_t size, const char *path, const uint8_t *data) {
+    const uint8_t *entry = header + MIXER_BANK_HEADER_SIZE;
+    bool ok = size >= MIXER_BANK_HEADER_SIZE + MIXER_BANK_ENTRY_SIZE
+            && memcmp(header, "FBNK", 4) == 0 && get32(header + 4) == MIXER_BANK_VERSION
+            && get32(header + 8) >= 1 && get32(header + 12) == MIXER_SAMPLE_RATE
+            && get32(header + 16) == ADPCM_BLOCK_FRAMES && get32(entry + 32) > 0;
+    // a file is only read as far as it goes, memory has to hold every block
+    ok = ok && (data == NULL || (get32(entry + 36) <= size
+            && adpcmBlockCount(get32(entry + 32))*(size_t)ADPCM_BLOCK_BYTES <= size - get32(entry + 36)));
+    if(!ok || strlen(path) >= sizeof(music.tracks[0].path)) {
+        TraceLog(LOG_WARNING, "MUSIC: %s isn't a baked track", path);
+        return -1;
+    }
+
+    Track *track = &music.tracks[music.trackCount];
+    strcpy(track->path, path);
+    track->data = data;
+    track->frames = get32(entry + 32);
+    track->offset = get32(entry + 36);
+    return music.trackCount++;
+}
+
+int musicLoad(const char *path) {
+    if(!music.started || music.trackCount == MUSIC_MAX_TRACKS) return -1;
+
+    FILE *file = fopen(path, "rb");
+    if(file == NULL) {
+        TraceLog(LOG_INFO, "MUSIC: no %s, playing without it", path);
+        return -1;
+    }
+    uint8_t header[MIXER_BANK_HEADER_SIZE + MIXER_BANK_ENTRY_SIZE];
+    bool ok = fread(header, 1, sizeof(header), file) == sizeof(header);
+    fclose(file);
+
+    return addTrack(header, ok ? sizeof(header) : 0, path, NULL);
+}
+
+int musicLoadMemory(const void *data, size_t size, const char *name) {
+    if(!music.started || music.trackCount == MUSIC_MAX_TRACKS) return -1;
+    return addTrack(data, size, name, data);
+}
+
+void musicPlay(int track, float fadeSeconds) {
+    if(!music.started) return;
+    if(track >= music.trackCount) track = -1;
+
+    pthread_mutex_lock(&music.lock);
+    music.pending = true;
+    music.pendingTrack = track;
+    music.pendingFade = fadeSeconds;
+    pthread_cond_signal(&music.wake);
+    pthread_mutex_unlock(&music.lock);
+}
+
+void musicSetVolume(float volume) {
+    if(!music.started) return;
+    pthread_mutex_lock(&music.lock);
+    music.volume = volume;
+    pthread_mutex_unlock(&music.lock);
+}
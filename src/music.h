@@ -0,0 +1,34 @@
+#ifndef MUSIC_H
+#define MUSIC_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Streamed background music. Tracks are sound banks baked by soundBake
+// (one sound each, IMA-ADPCM at the mixer rate). A music thread reads
+// and decodes them a block at a time into a PCM ring that the mixer
+// drains on the audio thread, so after musicPlay nothing about music
+// runs on the game thread. Tracks loop seamlessly and switching tracks
+// crossfades. A track that can't be loaded is -1; playing it fades to
+// silence and leaves the thread asleep.
+
+#define MUSIC_MAX_TRACKS 8
+// ~170 ms decoded ahead. Also how late a fade can start after musicPlay.
+#define MUSIC_RING_FRAMES 8192
+
+// After mixerInit
+bool musicInit(void);
+// After mixerClose, the mixer reads the ring until then
+void musicClose(void);
+
+// Index of the track, -1 if it's missing or not a baked track
+int musicLoad(const char *path);
+// A track already in memory (mapped from the asset archive), decoded from
+// there. data must stay until musicClose. name is for the log.
+int musicLoadMemory(const void *data, size_t size, const char *name);
+
+// Crossfade from whatever is playing to track over fadeSeconds
+void musicPlay(int track, float fadeSeconds);
+void musicSetVolume(float volume);
+
+#endif
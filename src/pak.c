@@ -0,0 +1,155 @@
+#include "pak.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static uint32_t get32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// mingw has no mmap, the archive is read in whole there
+static const uint8_t *mapFile(const char *path, size_t *size) {
+#ifdef _WIN32
+    int bytes = 0;
+    unsigned char *data = LoadFileData(path, &bytes);
+    *size = data ? (size_t)bytes : 0;
+    return data;
+#else
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) return NULL;
+    struct stat st;
+    void *data = MAP_FAILED;
+    if(fstat(fd, &st) == 0 && st.st_size > 0) data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file
+    if(data == MAP_FAILED) return NULL;
+    *size = st.st_size;
+    return data;
+#endif
+}
+
+static void unmapFile(const uint8_t *data, size_t size) {
+#ifdef _WIN32
+    (void)size;
+    UnloadFileData((unsigned char *)data);
+#else
+    munmap((void *)data, size);
+#endif
+}
+
+bool pakOpen(Pak *pak, const char *dir) {
+    memset(pak, 0, sizeof(*pak));
+    snprintf(pak->root, sizeof(pak->root), "%sassets/", dir);
+
+    const char *path = TextFormat("%sassets.pak", dir);
+    size_t size = 0;
+    const uint8_t *data = mapFile(path, &size);
+    if(data == NULL) {
+        TraceLog(LOG_INFO, "PAK: no %s, loading loose files", path);
+        return false;
+    }
+
+    uint32_t count = size >= PAK_HEADER_SIZE ? get32(data + 8) : 0;
+    if(size < PAK_HEADER_SIZE || memcmp(data, "FPAK", 4) != 0 || get32(data + 4) != PAK_VERSION
+       || (size - PAK_HEADER_SIZE)/PAK_ENTRY_SIZE < count) {
+        TraceLog(LOG_WARNING, "PAK: %s isn't a usable archive, rebuild it", path);
+        unmapFile(data, size);
+        return false;
+    }
+
+    pak->data = data;
+    pak->size = size;
+    pak->count = count;
+    return true;
+}
+
+void pakClose(Pak *pak) {
+    if(pak->data) unmapFile(pak->data, pak->size);
+    pak->data = NULL;
+    pak->size = 0;
+    pak->count = 0;
+}
+
+bool pakFind(const Pak *pak, const char *name, PakEntry *entry) {
+    for(uint32_t i = 0; i < pak->count; ++i) {
+        const uint8_t *e = pak->data + PAK_HEADER_SIZE + i*PAK_ENTRY_SIZE;
+        if(strncmp((const char *)e, name, PAK_NAME_SIZE) != 0) continue;
+
+        uint32_t offset = get32(e + 36), size = get32(e + 40);
+        if(offset > pak->size || size > pak->size - offset) {
+            TraceLog(LOG_WARNING, "PAK: %s is cut short, rebuild the archive", name);
+            return false;
+        }
+        memset(entry, 0, sizeof(*entry));
+        memcpy(entry->name, e, PAK_NAME_SIZE - 1);
+        entry->data = pak->data + offset;
+        entry->size = size;
+        entry->type = (int)get32(e + 44);
+        entry->width = (int)get32(e + 48);
+        entry->height = (int)get32(e + 52);
+        entry->mipmaps = (int)get32(e + 56);
+        entry->format = (int)get32(e + 60);
+        return true;
+    }
+    return false;
+}
+
+const char *pakPath(const Pak *pak, const char *name) {
+    return TextFormat("%s%s", pak->root, name);
+}
+
+// bytes of every mip level of an image entry
+static size_t imageSize(const PakEntry *entry) {
+    size_t size = 0;
+    int w = entry->width, h = entry->height;
+    for(int i = 0; i < entry->mipmaps; ++i) {
+        size += GetPixelDataSize(w, h, entry->format);
+        w = w > 1 ? w/2 : 1;
+        h = h > 1 ? h/2 : 1;
+    }
+    return size;
+}
+
+bool pakImage(const PakEntry *entry, Image *image) {
+    if(entry->type != PAK_IMAGE || entry->mipmaps < 1 || imageSize(entry) > entry->size) return false;
+    *image = (Image){(void *)entry->data, entry->width, entry->height, entry->mipmaps, entry->format};
+    return true;
+}
+
+const char *pakTexturePath(const Pak *pak, const char *name) {
+    const char *path = pakPath(pak, name);
+    const char *dds = TextFormat("%s/%s.dds", GetDirectoryPath(path), GetFileNameWithoutExt(path));
+    return FileExists(dds) ? dds : path;
+}
+
+Texture2D pakLoadTexture(const Pak *pak, const char *name) {
+    Texture2D texture = {0};
+    PakEntry entry;
+    Image image;
+    if(pakFind(pak, name, &entry)) {
+        // rlgl uploads from the mapping, the Image is only a view of it
+        if(pakImage(&entry, &image)) texture = LoadTextureFromImage(image);
+        else TraceLog(LOG_WARNING, "PAK: %s isn't an image", name);
+    }
+    if(texture.id == 0) texture = LoadTexture(pakTexturePath(pak, name));
+
+    if(texture.mipmaps > 1) SetTextureFilter(texture, TEXTURE_FILTER_TRILINEAR);
+    return texture;
+}
+
+char *pakLoadText(const Pak *pak, const char *name) {
+    PakEntry entry;
+    if(!pakFind(pak, name, &entry)) return LoadFileText(pakPath(pak, name));
+
+    char *text = MemAlloc((unsigned int)entry.size + 1);
+    if(text == NULL) return NULL;
+    memcpy(text, entry.data, entry.size);
+    text[entry.size] = '\0';
+    return text;
+}
@@ -0,0 +1,67 @@
+#ifndef PAK_H
+#define PAK_H
+
+#include <raylib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// The game's assets in one archive (assets.pak next to the executable,
+// built by pakBuild). An index up front, then every payload ready to use:
+// images as raw pixels in their GPU format, banks and manifests as they
+// are. The archive is memory mapped, a texture is uploaded straight from
+// the mapped pages and a sound bank is mixed from them, so nothing is
+// decoded or copied at startup and only what's used is ever read.
+//
+// Names are paths under assets/ ("sprites/atlas.png"). Without an archive
+// (cross builds) or for names it doesn't have, everything loads from the
+// loose files in <dir>assets/ instead.
+
+#define PAK_VERSION 1
+#define PAK_HEADER_SIZE 16
+#define PAK_ENTRY_SIZE 64
+#define PAK_NAME_SIZE 36
+#define PAK_ALIGN 64
+
+enum {
+    PAK_RAW,
+    PAK_IMAGE
+};
+
+typedef struct PakEntry {
+    char name[PAK_NAME_SIZE];
+    int type;
+    const void *data;
+    size_t size;
+    // PAK_IMAGE only
+    int width, height, mipmaps, format;
+} PakEntry;
+
+typedef struct Pak {
+    const uint8_t *data;
+    size_t size;
+    uint32_t count;
+    char root[256]; // loose files are <root><name>
+} Pak;
+
+// dir ends in a separator, like GetApplicationDirectory(). false if there's
+// no usable archive, the Pak then serves loose files.
+bool pakOpen(Pak *pak, const char *dir);
+void pakClose(Pak *pak);
+
+bool pakFind(const Pak *pak, const char *name, PakEntry *entry);
+// Where name is as a loose file
+const char *pakPath(const Pak *pak, const char *name);
+
+// From the archive, else the loose file; a baked .dds next to the loose
+// png is taken over it. Id 0 if there's neither.
+Texture2D pakLoadTexture(const Pak *pak, const char *name);
+// An image entry as an Image that points into the archive (don't unload
+// it), false if it isn't one
+bool pakImage(const PakEntry *entry, Image *image);
+// The loose file pakLoadTexture falls back to
+const char *pakTexturePath(const Pak *pak, const char *name);
+// NUL-terminated copy, MemFree it. NULL if there's neither.
+char *pakLoadText(const Pak *pak, const char *name);
+
+#endif
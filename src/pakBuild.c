@@ -0,0 +1,141 @@
+// Build-time asset archiver.
+//
+//   pakBuild <out.pak> <name>=<file>...
+//
+// Writes the archive pak.c maps at runtime. Layout, little endian:
+//
+//   header  "FPAK", u32 version, u32 count, u32 reserved
+//   entry   char name[36], u32 offset, size, type, width, height, mipmaps, format
+//   ...     payloads, each at a multiple of PAK_ALIGN
+//
+// .png and .dds files are decoded here and stored as the pixels raylib
+// uploads (every mip level, GPU format), everything else as it is.
+
+#include <raylib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "pak.h"
+
+typedef struct Item {
+    char name[PAK_NAME_SIZE];
+    const char *path;
+    int type;
+    Image image;
+    unsigned char *bytes;
+    uint32_t size;
+    uint32_t offset;
+} Item;
+
+static void put32(uint8_t *p, uint32_t v) {
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+static uint32_t imageSize(Image image) {
+    uint32_t size = 0;
+    int w = image.width, h = image.height;
+    for(int i = 0; i < image.mipmaps; ++i) {
+        size += GetPixelDataSize(w, h, image.format);
+        w = w > 1 ? w/2 : 1;
+        h = h > 1 ? h/2 : 1;
+    }
+    return size;
+}
+
+static bool load(Item *item) {
+    const char *ext = GetFileExtension(item->path);
+    if(ext && (strcmp(ext, ".png") == 0 || strcmp(ext, ".dds") == 0)) {
+        item->type = PAK_IMAGE;
+        item->image = LoadImage(item->path);
+        item->size = imageSize(item->image);
+        return item->image.data != NULL;
+    }
+
+    int size = 0;
+    item->type = PAK_RAW;
+    item->bytes = LoadFileData(item->path, &size);
+    item->size = (uint32_t)size;
+    return item->bytes != NULL;
+}
+
+int main(int argc, char **argv) {
+    if(argc < 3) {
+        fprintf(stderr, "usage: %s <out.pak> <name>=<file>...\n", argv[0]);
+        return 1;
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+
+    int count = argc - 2;
+    Item *items = calloc(count, sizeof(Item));
+    if(items == NULL) return 1;
+
+    uint32_t offset = PAK_HEADER_SIZE + count*PAK_ENTRY_SIZE;
+    for(int i = 0; i < count; ++i) {
+        Item *item = &items[i];
+        const char *arg = argv[2 + i];
+        const char *eq = strchr(arg, '=');
+        if(eq == NULL || eq == arg || eq - arg >= PAK_NAME_SIZE) {
+            fprintf(stderr, "bad entry %s, want name=file with a name under %d characters\n", arg, PAK_NAME_SIZE);
+            return 1;
+        }
+        memcpy(item->name, arg, eq - arg);
+        item->path = eq + 1;
+        if(!load(item)) {
+            fprintf(stderr, "can't load %s\n", item->path);
+            return 1;
+        }
+
+        offset = (offset + PAK_ALIGN - 1)/PAK_ALIGN*PAK_ALIGN;
+        item->offset = offset;
+        offset += item->size;
+    }
+
+    FILE *out = fopen(argv[1], "wb");
+    if(out == NULL) {
+        fprintf(stderr, "can't write %s\n", argv[1]);
+        return 1;
+    }
+
+    uint8_t header[PAK_HEADER_SIZE] = {0};
+    memcpy(header, "FPAK", 4);
+    put32(header + 4, PAK_VERSION);
+    put32(header + 8, count);
+    bool ok = fwrite(header, sizeof(header), 1, out) == 1;
+
+    for(int i = 0; i < count; ++i) {
+        const Item *item = &items[i];
+        uint8_t entry[PAK_ENTRY_SIZE] = {0};
+        memcpy(entry, item->name, PAK_NAME_SIZE);
+        put32(entry + 36, item->offset);
+        put32(entry + 40, item->size);
+        put32(entry + 44, item->type);
+        if(item->type == PAK_IMAGE) {
+            put32(entry + 48, item->image.width);
+            put32(entry + 52, item->image.height);
+            put32(entry + 56, item->image.mipmaps);
+            put32(entry + 60, item->image.format);
+        }
+        ok = ok && fwrite(entry, sizeof(entry), 1, out) == 1;
+    }
+
+    for(int i = 0; i < count && ok; ++i) {
+        Item *item = &items[i];
+        while(ok && ftell(out) < (long)item->offset) ok = fputc(0, out) != EOF;
+        const void *data = item->type == PAK_IMAGE ? item->image.data : item->bytes;
+        ok = ok && fwrite(data, 1, item->size, out) == item->size;
+
+        if(item->type == PAK_IMAGE) UnloadImage(item->image);
+        else UnloadFileData(item->bytes);
+    }
+    ok = fclose(out) == 0 && ok;
+    free(items);
+
+    if(!ok) {
+        fprintf(stderr, "can't write %s\n", argv[1]);
+        return 1;
+    }
+    printf("%s: %d entries, %u bytes\n", GetFileName(argv[1]), count, offset);
+    return 0;
+}
@@ -0,0 +1,108 @@
+#include "parallax.h"
+
+#include <stddef.h>
+
+// Default raylib vertex shader; texture0 is the back layer (the texture
+// of the quad we draw), texture1/texture2 are bound as extra samplers.
+// The baked layers have premultiplied alpha, loose ones straight.
+static const char *fragmentShader =
+    "#version 330\n"
+#ifdef ASSETS_PREMULTIPLIED
+    "#define OVER(c, l) (c*(1.0 - l.a) + l.rgb)\n"
+#else
+    "#define OVER(c, l) mix(c, l.rgb, l.a)\n"
+#endif
+    "in vec2 fragTexCoord;\n"
+    "in vec4 fragColor;\n"
+    "uniform sampler2D texture0;\n"
+    "uniform sampler2D texture1;\n"
+    "uniform sampler2D texture2;\n"
+    "uniform vec3 span;\n"       // screen width in each layer's u
+    "uniform vec3 offset;\n"     // scroll in each layer's u
+    "uniform vec4 clearColor;\n"
+    "out vec4 finalColor;\n"
+    "void main() {\n"
+    "    vec3 u = fragTexCoord.x*span - offset;\n"
+    "    vec3 c = clearColor.rgb;\n"
+    "    vec4 l = texture(texture0, vec2(u.x, fragTexCoord.y));\n"
+    "    c = OVER(c, l);\n"
+    "    l = texture(texture1, vec2(u.y, fragTexCoord.y));\n"
+    "    c = OVER(c, l);\n"
+    "    l = texture(texture2, vec2(u.z, fragTexCoord.y));\n"
+    "    c = OVER(c, l);\n"
+    "    finalColor = vec4(c, 1.0)*fragColor;\n"
+    "}\n";
+
+float parallaxLayerWidth(const Parallax *parallax, int layer) {
+    const Texture2D *t = &parallax->layers[layer];
+    return t->width*(parallax->screenHeight/t->height);
+}
+
+void parallaxInit(Parallax *parallax, const Texture2D layers[PARALLAX_LAYERS], Color clear, float screenWidth, float screenHeight) {
+    *parallax = (Parallax){0};
+    for(int i = 0; i < PARALLAX_LAYERS; ++i) parallax->layers[i] = layers[i];
+    parallax->clear = clear;
+    parallax->screenWidth = screenWidth;
+    parallax->screenHeight = screenHeight;
+
+    for(int i = 0; i < PARALLAX_LAYERS; ++i) {
+        if(layers[i].id == 0) return;
+    }
+
+    // a shader that fails to compile comes back as rlgl's default one,
+    // which has none of our uniforms
+    parallax->shader = LoadShaderFromMemory(NULL, fragmentShader);
+    parallax->spanLoc = GetShaderLocation(parallax->shader, "span");
+    parallax->offsetLoc = GetShaderLocation(parallax->shader, "offset");
+    parallax->clearLoc = GetShaderLocation(parallax->shader, "clearColor");
+    parallax->textureLocs[0] = GetShaderLocation(parallax->shader, "texture1");
+    parallax->textureLocs[1] = GetShaderLocation(parallax->shader, "texture2");
+    if(!IsShaderReady(parallax->shader) || parallax->spanLoc < 0 || parallax->offsetLoc < 0) {
+        TraceLog(LOG_WARNING, "PARALLAX: shader unavailable, drawing the layers one by one");
+        UnloadShader(parallax->shader);
+        parallax->shader = (Shader){0};
+        return;
+    }
+
+    for(int i = 0; i < PARALLAX_LAYERS; ++i) SetTextureWrap(layers[i], TEXTURE_WRAP_REPEAT);
+
+    float span[PARALLAX_LAYERS];
+    for(int i = 0; i < PARALLAX_LAYERS; ++i) span[i] = screenWidth/parallaxLayerWidth(parallax, i);
+    SetShaderValue(parallax->shader, parallax->spanLoc, span, SHADER_UNIFORM_VEC3);
+
+    float c[4] = {clear.r/255.0f, clear.g/255.0f, clear.b/255.0f, 1.0f};
+    SetShaderValue(parallax->shader, parallax->clearLoc, c, SHADER_UNIFORM_VEC4);
+
+    parallax->useShader = true;
+}
+
+void parallaxUnload(Parallax *parallax) {
+    if(parallax->useShader) UnloadShader(parallax->shader);
+    parallax->useShader = false;
+}
+
+void parallaxDraw(const Parallax *parallax, const float scroll[PARALLAX_LAYERS], SpriteBatch *batch, int firstLayer) {
+    if(parallax->useShader) {
+        float offset[PARALLAX_LAYERS];
+        for(int i = 0; i < PARALLAX_LAYERS; ++i) offset[i] = scroll[i]/parallaxLayerWidth(parallax, i);
+
+        Shader shader = parallax->shader;
+        BeginShaderMode(shader);
+            SetShaderValue(shader, parallax->offsetLoc, offset, SHADER_UNIFORM_VEC3);
+            SetShaderValueTexture(shader, parallax->textureLocs[0], parallax->layers[1]);
+            SetShaderValueTexture(shader, parallax->textureLocs[1], parallax->layers[2]);
+            Texture2D back = parallax->layers[0];
+            DrawTexturePro(back, (Rectangle){0, 0, back.width, back.height},
+                           (Rectangle){0, 0, parallax->screenWidth, parallax->screenHeight}, (Vector2){0, 0}, 0.0f, WHITE);
+        EndShaderMode();
+        return;
+    }
+
+    ClearBackground(parallax->clear);
+    for(int i = 0; i < PARALLAX_LAYERS; ++i) {
+        float w = parallaxLayerWidth(parallax, i);
+        Sprite layer = spriteFromTexture(parallax->layers[i]);
+        spriteBatchDraw(batch, firstLayer + i, layer, (Rectangle){scroll[i], 0, w, parallax->screenHeight}, WHITE);
+        spriteBatchDraw(batch, firstLayer + i, layer, (Rectangle){scroll[i] + w, 0, w, parallax->screenHeight}, WHITE);
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef PARALLAX_H
+#define PARALLAX_H
+
+#include <raylib.h>
+#include <stdbool.h>
+
+#include "spriteBatch.h"
+
+// The three background layers in one full-screen quad. A fragment shader
+// samples every layer with repeating UVs offset by its scroll and blends
+// them over the clear colour, so each pixel is written once and there is
+// no ClearBackground. Without the shader (GL without GLSL 330, compile
+// error) it falls back to two sprite-batch quads per layer on top of a
+// clear, the way the game always drew it.
+
+#define PARALLAX_LAYERS 3
+
+typedef struct Parallax {
+    Texture2D layers[PARALLAX_LAYERS]; // back to front
+    Color clear;
+    float screenWidth;
+    float screenHeight;
+
+    Shader shader;
+    bool useShader;
+    int spanLoc, offsetLoc, clearLoc;
+    int textureLocs[PARALLAX_LAYERS - 1];
+} Parallax;
+
+// Layers are scaled to the screen height, the Parallax doesn't own them
+void parallaxInit(Parallax *parallax, const Texture2D layers[PARALLAX_LAYERS], Color clear, float screenWidth, float screenHeight);
+void parallaxUnload(Parallax *parallax);
+
+// Width of a layer on screen, scroll wraps at this
+float parallaxLayerWidth(const Parallax *parallax, int layer);
+
+// scroll[i] is the x of layer i in pixels (<= 0). The fallback adds its
+// quads to batch on layers firstLayer..firstLayer+2, the shader path
+// draws right away, so call before the batch is submitted either way.
+void parallaxDraw(const Parallax *parallax, const float scroll[PARALLAX_LAYERS], SpriteBatch *batch, int firstLayer);
+
+#endif
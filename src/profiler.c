@@ -0,0 +1,201 @@
+#include "profiler.h"
+
+#include <raylib.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MAX_SPANS 16
+#define GRAPH_FRAMES 240
+
+typedef struct ProfileSpan {
+    unsigned char zone;
+    float begin; // ns from the start of the frame
+    float end;
+} ProfileSpan;
+
+typedef struct ProfileFrame {
+    double start; // ns since the first frame
+    double duration; // 0 until the next frame begins
+    unsigned long long index;
+    ProfileSpan spans[MAX_SPANS];
+    int spanCount;
+    int open[PROFILE_ZONE_COUNT]; // span index of each running zone, -1 if none
+} ProfileFrame;
+
+static const char *zoneNames[PROFILE_ZONE_COUNT] = {"audio", "update", "input", "draw", "present"};
+static const Color zoneColors[PROFILE_ZONE_COUNT] = {
+    {255, 161, 0, 255}, {0, 228, 48, 255}, {102, 191, 255, 255}, {200, 122, 255, 255}, {230, 41, 55, 255}
+};
+
+static struct {
+    ProfileFrame frames[PROFILER_HISTORY];
+    int current; // index into frames
+    int count;
+    unsigned long long frameIndex;
+    double origin;
+    bool overlay;
+} profiler = {.current = -1};
+
+static double nowNs(void) {
+    struct timespec ts;
+#if defined(_WIN32)
+    timespec_get(&ts, TIME_UTC);
+#else
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+#endif
+    return ts.tv_sec*1e9 + ts.tv_nsec;
+}
+
+void profilerFrameBegin(void) {
+    double now = nowNs();
+    if(profiler.current < 0) profiler.origin = now;
+    now -= profiler.origin;
+
+    if(profiler.current >= 0) {
+        ProfileFrame *last = &profiler.frames[profiler.current];
+        last->duration = now - last->start;
+    }
+
+    profiler.current = (profiler.current + 1) % PROFILER_HISTORY;
+    if(profiler.count < PROFILER_HISTORY) ++profiler.count;
+
+    ProfileFrame *frame = &profiler.frames[profiler.current];
+    frame->start = now;
+    frame->duration = 0.0;
+    frame->index = profiler.frameIndex++;
+    frame->spanCount = 0;
+    for(int z = 0; z < PROFILE_ZONE_COUNT; ++z) frame->open[z] = -1;
+}
+
+void profilerBegin(ProfileZone zone) {
+    if(profiler.current < 0) return;
+    ProfileFrame *frame = &profiler.frames[profiler.current];
+    if(frame->spanCount == MAX_SPANS) return;
+
+    ProfileSpan *span = &frame->spans[frame->spanCount];
+    span->zone = (unsigned char)zone;
+    span->begin = (float)(nowNs() - profiler.origin - frame->start);
+    span->end = span->begin;
+    frame->open[zone] = frame->spanCount++;
+}
+
+void profilerEnd(ProfileZone zone) {
+    if(profiler.current < 0) return;
+    ProfileFrame *frame = &profiler.frames[profiler.current];
+    if(frame->open[zone] < 0) return;
+
+    frame->spans[frame->open[zone]].end = (float)(nowNs() - profiler.origin - frame->start);
+    frame->open[zone] = -1;
+}
+
+// completed frames, oldest first
+static const ProfileFrame *historyFrame(int i) {
+    int completed = profiler.count - 1;
+    int oldest = (profiler.current - completed + PROFILER_HISTORY) % PROFILER_HISTORY;
+    return &profiler.frames[(oldest + i) % PROFILER_HISTORY];
+}
+
+static int compareFloat(const void *a, const void *b) {
+    float x = *(const float *)a, y = *(const float *)b;
+    return (x > y) - (x < y);
+}
+
+static float zoneTotal(const ProfileFrame *frame, int zone) {
+    float total = 0.0f;
+    for(int s = 0; s < frame->spanCount; ++s) {
+        if(frame->spans[s].zone == zone) total += frame->spans[s].end - frame->spans[s].begin;
+    }
+    return total;
+}
+
+void profilerHandleKeys(void) {
+    if(IsKeyPressed(KEY_F1)) profiler.overlay = !profiler.overlay;
+    if(IsKeyPressed(KEY_F2)) {
+        bool ok = profilerExportTrace("profile_trace.json") && profilerExportCsv("profile.csv");
+        TraceLog(ok ? LOG_INFO : LOG_WARNING, ok ? "PROFILER: wrote profile_trace.json and profile.csv" : "PROFILER: export failed");
+    }
+}
+
+void profilerDrawOverlay(int x, int y) {
+    if(!profiler.overlay) return;
+
+    int completed = profiler.count - 1;
+    if(completed < 1) return;
+
+    static float sorted[PROFILER_HISTORY];
+    for(int i = 0; i < completed; ++i) sorted[i] = (float)(historyFrame(i)->duration*1e-6);
+    const ProfileFrame *last = historyFrame(completed - 1);
+    float current = sorted[completed - 1];
+
+    qsort(sorted, completed, sizeof(float), compareFloat);
+    float p50 = sorted[completed/2];
+    float p99 = sorted[(completed*99)/100];
+    float worst = sorted[completed - 1];
+
+    const int width = GRAPH_FRAMES + 20, graphHeight = 80;
+    const int height = 60 + PROFILE_ZONE_COUNT*16 + graphHeight;
+    DrawRectangle(x, y, width, height, (Color){0, 0, 0, 190});
+
+    DrawText(TextFormat("frame %6.2f ms", current), x + 10, y + 8, 20, RAYWHITE);
+    DrawText(TextFormat("p50 %.2f  p99 %.2f  max %.2f", p50, p99, worst), x + 10, y + 32, 10, LIGHTGRAY);
+
+    int line = y + 50;
+    for(int z = 0; z < PROFILE_ZONE_COUNT; ++z) {
+        DrawRectangle(x + 10, line + 2, 8, 8, zoneColors[z]);
+        DrawText(TextFormat("%-8s %6.3f ms", zoneNames[z], zoneTotal(last, z)*1e-6f), x + 24, line, 10, LIGHTGRAY);
+        line += 16;
+    }
+
+    // one bar per frame, full height is 33 ms, the line marks 60 fps
+    int graphY = line + 4;
+    int first = completed > GRAPH_FRAMES ? completed - GRAPH_FRAMES : 0;
+    for(int i = first; i < completed; ++i) {
+        float ms = (float)(historyFrame(i)->duration*1e-6);
+        int h = (int)(ms/33.3f*graphHeight);
+        if(h > graphHeight) h = graphHeight;
+        Color c = ms > 17.5f ? RED : GREEN;
+        DrawRectangle(x + 10 + (i - first), graphY + graphHeight - h, 1, h, c);
+    }
+    int target = graphY + graphHeight - graphHeight/2;
+    DrawLine(x + 10, target, x + 10 + GRAPH_FRAMES, target, YELLOW);
+}
+
+bool profilerExportTrace(const char *path) {
+    FILE *out = fopen(path, "w");
+    if(out == NULL) return false;
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    for(int i = 0; i < profiler.count - 1; ++i) {
+        const ProfileFrame *f = historyFrame(i);
+        fprintf(out, "%s{\"name\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%llu}}",
+                first ? "" : ",\n", f->start*1e-3, f->duration*1e-3, f->index);
+        first = false;
+        for(int s = 0; s < f->spanCount; ++s) {
+            const ProfileSpan *span = &f->spans[s];
+            fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+                    zoneNames[span->zone], (f->start + span->begin)*1e-3, (span->end - span->begin)*1e-3);
+        }
+    }
+    fprintf(out, "\n]}\n");
+    return fclose(out) == 0;
+}
+
+bool profilerExportCsv(const char *path) {
+    FILE *out = fopen(path, "w");
+    if(out == NULL) return false;
+
+    fprintf(out, "frame,start_ms,frame_ms");
+    for(int z = 0; z < PROFILE_ZONE_COUNT; ++z) fprintf(out, ",%s_ms", zoneNames[z]);
+    fprintf(out, "\n");
+
+    for(int i = 0; i < profiler.count - 1; ++i) {
+        const ProfileFrame *f = historyFrame(i);
+        fprintf(out, "%llu,%.4f,%.4f", f->index, f->start*1e-6, f->duration*1e-6);
+        for(int z = 0; z < PROFILE_ZONE_COUNT; ++z) fprintf(out, ",%.4f", zoneTotal(f, z)*1e-6f);
+        fprintf(out, "\n");
+    }
+    return fclose(out) == 0;
+}
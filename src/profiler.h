@@ -0,0 +1,52 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <stdbool.h>
+
+// Per-phase frame timing. Wrap each phase of the main loop in
+// PROFILE_BEGIN/PROFILE_END; the last PROFILER_HISTORY frames are kept
+// for the overlay and for export. Built only with -DFLAPPY_PROFILER,
+// otherwise every macro below expands to nothing.
+
+#define PROFILER_HISTORY 1024
+
+typedef enum ProfileZone {
+    PROFILE_AUDIO,
+    PROFILE_UPDATE,
+    PROFILE_INPUT,
+    PROFILE_DRAW,
+    PROFILE_PRESENT, // EndDrawing: batch flush, swap, event poll and the FPS wait
+    PROFILE_ZONE_COUNT
+} ProfileZone;
+
+#if defined(FLAPPY_PROFILER)
+
+void profilerFrameBegin(void);
+void profilerBegin(ProfileZone zone);
+void profilerEnd(ProfileZone zone);
+
+// F1 toggles the overlay, F2 writes profile_trace.json and profile.csv
+void profilerHandleKeys(void);
+void profilerDrawOverlay(int x, int y);
+
+// Chrome trace-event JSON (chrome://tracing, Perfetto) and one CSV row per frame
+bool profilerExportTrace(const char *path);
+bool profilerExportCsv(const char *path);
+
+#define PROFILE_FRAME_BEGIN() profilerFrameBegin()
+#define PROFILE_BEGIN(zone) profilerBegin(zone)
+#define PROFILE_END(zone) profilerEnd(zone)
+#define PROFILE_HANDLE_KEYS() profilerHandleKeys()
+#define PROFILE_DRAW_OVERLAY(x, y) profilerDrawOverlay(x, y)
+
+#else
+
+#define PROFILE_FRAME_BEGIN() ((void)0)
+#define PROFILE_BEGIN(zone) ((void)0)
+#define PROFILE_END(zone) ((void)0)
+#define PROFILE_HANDLE_KEYS() ((void)0)
+#define PROFILE_DRAW_OVERLAY(x, y) ((void)0)
+
+#endif
+
+#endif
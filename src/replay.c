@@ -0,0 +1,314 @@
+#include "replay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#define HEADER_SIZE 88
+#define KEYFRAME_SIZE (16 + 8 + 8*MAX_PIPES + 12)
+
+// little endian helpers, files are the same on every platform
+static void put32(uint8_t *p, uint32_t v) {
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+static uint32_t get32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void putFloat(uint8_t *p, float f) {
+    uint32_t v;
+    memcpy(&v, &f, sizeof(v));
+    put32(p, v);
+}
+
+static float getFloat(const uint8_t *p) {
+    uint32_t v = get32(p);
+    float f;
+    memcpy(&f, &v, sizeof(f));
+    return f;
+}
+
+static void putConfig(uint8_t *p, const SimConfig *c) {
+    const float fields[11] = {
+        c->screenWidth, c->screenHeight, c->gravity, c->jumpForce, c->pipeWidth, c->gapSize,
+        c->pipeSpeed, c->pipeSpacing, c->birdWidth, c->birdHeight, c->hitShrink
+    };
+    for(int i = 0; i < 11; ++i) putFloat(p + i*4, fields[i]);
+}
+
+static void getConfig(const uint8_t *p, SimConfig *c) {
+    float *fields[11] = {
+        &c->screenWidth, &c->screenHeight, &c->gravity, &c->jumpForce, &c->pipeWidth, &c->gapSize,
+        &c->pipeSpeed, &c->pipeSpacing, &c->birdWidth, &c->birdHeight, &c->hitShrink
+    };
+    for(int i = 0; i < 11; ++i) *fields[i] = getFloat(p + i*4);
+}
+
+static bool reserve(uint8_t **buffer, size_t *capacity, size_t needed) {
+    if(needed <= *capacity) return true;
+    size_t grown = *capacity ? *capacity*2 : 256;
+    while(grown < needed) grown *= 2;
+    uint8_t *p = realloc(*buffer, grown);
+    if(p == NULL) return false;
+    *buffer = p;
+    *capacity = grown;
+    return true;
+}
+
+void replayWriterBegin(ReplayWriter *writer, const SimWorld *world) {
+    replayWriterFree(writer);
+    writer->config = world->config;
+    writer->seed = world->seed;
+}
+
+bool replayWriterJump(ReplayWriter *writer, const SimWorld *world) {
+    // snapshot before the jump so seeking lands on a tick that decodes cleanly
+    if(writer->jumpCount > 0 && writer->jumpCount % REPLAY_KEYFRAME_INTERVAL == 0) {
+        size_t capacity = (size_t)writer->keyframeCapacity*KEYFRAME_SIZE;
+        if(!reserve(&writer->keyframes, &capacity, (size_t)(writer->keyframeCount + 1)*KEYFRAME_SIZE)) return false;
+        writer->keyframeCapacity = capacity/KEYFRAME_SIZE;
+
+        uint8_t *k = writer->keyframes + (size_t)writer->keyframeCount*KEYFRAME_SIZE;
+        put32(k + 0, writer->jumpCount);
+        put32(k + 4, world->tick);
+        put32(k + 8, writer->lastJumpTick);
+        put32(k + 12, (uint32_t)writer->jumpsSize);
+        putFloat(k + 16, world->birdY);
+        putFloat(k + 20, world->birdVel);
+        // pipes left to right, their ids run up to pipesSpawned
+        for(int i = 0; i < MAX_PIPES; ++i) {
+            putFloat(k + 24 + i*4, world->pipeX[simPipeSlot(world, i)]);
+            putFloat(k + 24 + MAX_PIPES*4 + i*4, world->gapY[simPipeSlot(world, i)]);
+        }
+        put32(k + 24 + MAX_PIPES*8, world->nextScore);
+        put32(k + 28 + MAX_PIPES*8, (uint32_t)world->score);
+        put32(k + 32 + MAX_PIPES*8, world->pipesSpawned);
+        ++writer->keyframeCount;
+    }
+
+    // LEB128 varint of the tick delta
+    if(!reserve(&writer->jumps, &writer->jumpsCapacity, writer->jumpsSize + 5)) return false;
+    uint32_t delta = world->tick - writer->lastJumpTick;
+    do {
+        uint8_t byte = delta & 0x7f;
+        delta >>= 7;
+        writer->jumps[writer->jumpsSize++] = byte | (delta ? 0x80 : 0);
+    } while(delta);
+
+    writer->lastJumpTick = world->tick;
+    ++writer->jumpCount;
+    return true;
+}
+
+bool replayWriterSave(const ReplayWriter *writer, const char *path, const SimWorld *final) {
+    uint8_t header[HEADER_SIZE] = {0};
+    memcpy(header, "FBRP", 4);
+    header[4] = REPLAY_VERSION & 0xff;
+    header[5] = REPLAY_VERSION >> 8;
+    header[6] = HEADER_SIZE;
+    header[7] = writer->config.birdMask && writer->config.pipeMask ? REPLAY_PIXEL_COLLISION : 0;
+    put32(header + 8, (uint32_t)writer->seed);
+    put32(header + 12, (uint32_t)(writer->seed >> 32));
+    put32(header + 16, SIM_TICK_RATE);
+    put32(header + 20, writer->jumpCount);
+    put32(header + 24, final->tick);
+    put32(header + 28, (uint32_t)final->score);
+    put32(header + 32, REPLAY_KEYFRAME_INTERVAL);
+    put32(header + 36, writer->keyframeCount);
+    put32(header + 40, (uint32_t)writer->jumpsSize);
+    putConfig(header + 44, &writer->config);
+
+    FILE *file = fopen(path, "wb");
+    if(file == NULL) return false;
+
+    bool ok = fwrite(header, 1, HEADER_SIZE, file) == HEADER_SIZE;
+    if(ok && writer->jumpsSize) ok = fwrite(writer->jumps, 1, writer->jumpsSize, file) == writer->jumpsSize;
+    size_t keyframeBytes = (size_t)writer->keyframeCount*KEYFRAME_SIZE;
+    if(ok && keyframeBytes) ok = fwrite(writer->keyframes, 1, keyframeBytes, file) == keyframeBytes;
+
+    if(fclose(file) != 0) ok = false;
+    return ok;
+}
+
+void replayWriterFree(ReplayWriter *writer) {
+    free(writer->jumps);
+    free(writer->keyframes);
+    memset(writer, 0, sizeof(*writer));
+}
+
+static bool mapFile(Replay *replay, const char *path) {
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER size;
+    HANDLE mapping = NULL;
+    if(GetFileSizeEx(file, &size) && size.QuadPart > 0) {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+    CloseHandle(file);
+    if(mapping == NULL) return false;
+
+    replay->base = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if(replay->base == NULL) {
+        CloseHandle(mapping);
+        return false;
+    }
+    replay->size = (size_t)size.QuadPart;
+    replay->handle = mapping;
+    return true;
+#else
+    int fd = open(path, O_RDONLY);
+    if(fd < 0) return false;
+
+    struct stat st;
+    if(fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+
+    void *base = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(base == MAP_FAILED) return false;
+
+    // playback walks the jump stream front to back
+    madvise(base, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    replay->base = base;
+    replay->size = (size_t)st.st_size;
+    return true;
+#endif
+}
+
+bool replayOpen(Replay *replay, const char *path) {
+    memset(replay, 0, sizeof(*replay));
+    if(!mapFile(replay, path)) return false;
+
+    const uint8_t *p = replay->base;
+    if(replay->size < HEADER_SIZE || memcmp(p, "FBRP", 4) != 0 ||
+       (p[4] | p[5] << 8) != REPLAY_VERSION || p[6] != HEADER_SIZE) {
+        replayClose(replay);
+        return false;
+    }
+
+    replay->seed = get32(p + 8) | (uint64_t)get32(p + 12) << 32;
+    replay->tickRate = get32(p + 16);
+    replay->jumpCount = get32(p + 20);
+    replay->endTick = get32(p + 24);
+    replay->finalScore = (int)get32(p + 28);
+    replay->keyframeCount = get32(p + 36);
+    replay->jumpsSize = get32(p + 40);
+    getConfig(p + 44, &replay->config);
+    replay->flags = p[7];
+
+    size_t needed = HEADER_SIZE + replay->jumpsSize + (size_t)replay->keyframeCount*KEYFRAME_SIZE;
+    if(replay->tickRate != SIM_TICK_RATE || get32(p + 32) != REPLAY_KEYFRAME_INTERVAL || replay->size < needed) {
+        replayClose(replay);
+        return false;
+    }
+
+    replay->jumps = p + HEADER_SIZE;
+    replay->keyframes = replay->jumps + replay->jumpsSize;
+    return true;
+}
+
+void replayClose(Replay *replay) {
+    if(replay->base) {
+#if defined(_WIN32)
+        UnmapViewOfFile(replay->base);
+        CloseHandle(replay->handle);
+#else
+        munmap(replay->base, replay->size);
+#endif
+    }
+    memset(replay, 0, sizeof(*replay));
+}
+
+// decode the next jump tick, base is the previous jump's tick
+static void cursorNext(const Replay *replay, ReplayCursor *cursor, uint32_t base) {
+    cursor->hasNext = false;
+    if(cursor->jumpIndex >= replay->jumpCount) return;
+
+    uint32_t delta = 0;
+    for(int shift = 0; shift < 35 && cursor->offset < replay->jumpsSize; shift += 7) {
+        uint8_t byte = replay->jumps[cursor->offset++];
+        delta |= (uint32_t)(byte & 0x7f) << shift;
+        if(!(byte & 0x80)) {
+            cursor->nextJumpTick = base + delta;
+            cursor->hasNext = true;
+            return;
+        }
+    }
+}
+
+void replayStart(const Replay *replay, SimWorld *world, ReplayCursor *cursor) {
+    simInit(world, &replay->config, replay->seed);
+    memset(cursor, 0, sizeof(*cursor));
+    cursorNext(replay, cursor, 0);
+}
+
+bool replayJumpAt(const Replay *replay, ReplayCursor *cursor, uint32_t tick) {
+    if(!cursor->hasNext || cursor->nextJumpTick != tick) return false;
+    ++cursor->jumpIndex;
+    cursorNext(replay, cursor, tick);
+    return true;
+}
+
+void replaySeek(const Replay *replay, uint32_t tick, SimWorld *world, ReplayCursor *cursor) {
+    // last keyframe at or before tick
+    int lo = 0, hi = (int)replay->keyframeCount - 1, found = -1;
+    while(lo <= hi) {
+        int mid = (lo + hi)/2;
+        if(get32(replay->keyframes + (size_t)mid*KEYFRAME_SIZE + 4) <= tick) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    // moving forward past no keyframe, just keep simulating from where we are
+    uint32_t keyTick = found < 0 ? 0 : get32(replay->keyframes + (size_t)found*KEYFRAME_SIZE + 4);
+    if(world->tick > tick || world->tick < keyTick) {
+        if(found < 0) {
+            replayStart(replay, world, cursor);
+        } else {
+            const uint8_t *k = replay->keyframes + (size_t)found*KEYFRAME_SIZE;
+            simInit(world, &replay->config, replay->seed);
+
+            world->tick = get32(k + 4);
+            world->birdY = getFloat(k + 16);
+            world->birdVel = getFloat(k + 20);
+            world->pipesSpawned = get32(k + 32 + MAX_PIPES*8);
+            world->nextScore = get32(k + 24 + MAX_PIPES*8);
+            world->pipeHead = 0;
+            world->pipeCount = MAX_PIPES;
+            for(int i = 0; i < MAX_PIPES; ++i) {
+                world->pipeX[i] = getFloat(k + 24 + i*4);
+                world->gapY[i] = getFloat(k + 24 + MAX_PIPES*4 + i*4);
+                world->pipeId[i] = world->pipesSpawned - MAX_PIPES + i;
+            }
+            world->score = (int)get32(k + 28 + MAX_PIPES*8);
+
+            cursor->jumpIndex = get32(k + 0);
+            cursor->offset = get32(k + 12);
+            cursorNext(replay, cursor, get32(k + 8));
+        }
+    }
+
+    // fast forward from there, decoding is far cheaper than the sim step
+    while(world->tick < tick && !world->gameOver) {
+        bool jump = replayJumpAt(replay, cursor, world->tick);
+        simStep(world, (SimInput){jump}, SIM_TICK_DT);
+    }
+}
@@ -0,0 +1,94 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "sim.h"
+
+// Deterministic replays. A run is fully described by its seed, its tuning
+// and the ticks on which the bird jumped, so that is all a file stores:
+//
+//   header    magic, version, flags, seed, tick rate, SimConfig, totals
+//   jumps     LEB128 varints, each the tick delta to the previous jump
+//   keyframes every REPLAY_KEYFRAME_INTERVAL jumps: jump index, tick,
+//             byte offset into the jump stream and a SimWorld snapshot
+//
+// A typical jump costs 1-2 bytes. Keyframes let playback seek without
+// simulating from tick 0. Files are read through a memory map.
+//
+// Only endless runs (config.course NULL), the file has no room for a course.
+
+#define REPLAY_VERSION 2
+#define REPLAY_KEYFRAME_INTERVAL 64
+
+// Recorded with pixel collision. The masks aren't in the file, the player
+// has to put the same ones in Replay.config.
+#define REPLAY_PIXEL_COLLISION (1 << 0)
+
+typedef struct ReplayWriter {
+    SimConfig config;
+    uint64_t seed;
+
+    uint8_t *jumps;
+    size_t jumpsSize;
+    size_t jumpsCapacity;
+
+    uint8_t *keyframes;
+    uint32_t keyframeCount;
+    uint32_t keyframeCapacity;
+
+    uint32_t jumpCount;
+    uint32_t lastJumpTick;
+} ReplayWriter;
+
+typedef struct Replay {
+    SimConfig config;
+    uint64_t seed;
+    uint32_t tickRate;
+    uint32_t jumpCount;
+    uint32_t endTick;
+    int finalScore;
+    uint8_t flags; // REPLAY_*
+
+    const uint8_t *jumps;
+    size_t jumpsSize;
+    const uint8_t *keyframes;
+    uint32_t keyframeCount;
+
+    // mapping
+    void *base;
+    size_t size;
+    void *handle;
+} Replay;
+
+// Where playback is in the jump stream
+typedef struct ReplayCursor {
+    size_t offset;
+    uint32_t jumpIndex;
+    uint32_t nextJumpTick;
+    bool hasNext;
+} ReplayCursor;
+
+// Start recording a run from its initial world (tick 0)
+void replayWriterBegin(ReplayWriter *writer, const SimWorld *world);
+// Record that the next simStep of world jumps. Call before that step.
+bool replayWriterJump(ReplayWriter *writer, const SimWorld *world);
+// Write the file. final is the world at the end of the run.
+bool replayWriterSave(const ReplayWriter *writer, const char *path, const SimWorld *final);
+void replayWriterFree(ReplayWriter *writer);
+
+bool replayOpen(Replay *replay, const char *path);
+void replayClose(Replay *replay);
+
+// Reset world and cursor to the start of the replay
+void replayStart(const Replay *replay, SimWorld *world, ReplayCursor *cursor);
+// True if the replay jumps on this tick, advances the cursor past it
+bool replayJumpAt(const Replay *replay, ReplayCursor *cursor, uint32_t tick);
+// Put world/cursor at tick (or where the run ended, if earlier). world and
+// cursor must come from replayStart/replaySeek on the same replay. Starts
+// from the closest keyframe unless world is already between it and tick.
+void replaySeek(const Replay *replay, uint32_t tick, SimWorld *world, ReplayCursor *cursor);
+
+#endif
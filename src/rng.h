@@ -0,0 +1,35 @@
+#ifndef RNG_H
+#define RNG_H
+
+#include <stdint.h>
+
+// Counter-based random numbers: the value for (seed, counter) is a pure
+// hash, so any element of a stream can be computed directly and every
+// world/thread can have its own stream without sharing state.
+
+// SplitMix64 finalizer
+static inline uint64_t rngMix64(uint64_t x) {
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30))*0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27))*0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// 64 random bits for element counter of stream seed
+static inline uint64_t rngAt(uint64_t seed, uint64_t counter) {
+    return rngMix64(rngMix64(seed) + counter*0x9e3779b97f4a7c15ull);
+}
+
+// Uniform integer in [min, max], inclusive like raylib's GetRandomValue
+static inline int rngRangeAt(uint64_t seed, uint64_t counter, int min, int max) {
+    if(max <= min) return min;
+    uint64_t span = (uint64_t)((int64_t)max - min) + 1;
+    return min + (int)(((rngAt(seed, counter) >> 32)*span) >> 32);
+}
+
+// Uniform float in [0, 1)
+static inline float rngFloatAt(uint64_t seed, uint64_t counter) {
+    return (rngAt(seed, counter) >> 40)*(1.0f/16777216.0f);
+}
+
+#endif
@@ -0,0 +1,494 @@
+// Headless episode runner. Plays lots of seeded games with a bot policy
+// across every core and prints score statistics for each point of a
+// tuning grid, e.g.
+//
+//   runner --episodes 100000 --gravity 800:1200:5 --gap-size 200:300:3
+//
+// Work is split into chunks of episodes that share a grid point. Every
+// worker owns a range of chunks and steals half of someone else's range
+// when it runs dry. Results are kept per worker and merged after join.
+// With --events every episode is played on its own with simRunEvents,
+// from one event to the next, instead of tick by tick in a batch.
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "rng.h"
+#include "sim.h"
+#include "simBatch.h"
+
+#define CHUNK_EPISODES 64
+#define CACHE_LINE 64
+
+typedef enum Policy {
+    POLICY_HEURISTIC,
+    POLICY_RANDOM,
+    POLICY_IDLE
+} Policy;
+
+// one swept tuning constant, count evenly spaced values from min to max
+typedef struct Sweep {
+    const char *name;
+    float min;
+    float max;
+    int count;
+} Sweep;
+
+enum { SWEEP_GRAVITY, SWEEP_JUMP_FORCE, SWEEP_GAP_SIZE, SWEEP_PIPE_SPACING, SWEEP_COUNT };
+
+typedef struct CellStats {
+    uint64_t episodes;
+    uint64_t truncated; // hit maxTicks without dying
+    uint64_t ticks;
+    double scoreSum;
+    double scoreSqSum;
+    int maxScore;
+} CellStats;
+
+typedef struct Runner {
+    SimConfig base;
+    Sweep sweeps[SWEEP_COUNT];
+    int cells;
+
+    uint64_t episodes; // per cell
+    uint64_t chunksPerCell;
+    uint64_t seed;
+    uint32_t maxTicks;
+    Policy policy;
+    bool events;
+
+    int threadCount;
+    struct Worker *workers;
+} Runner;
+
+typedef struct Worker {
+    // [begin, end) of chunk indices, begin in the low half. Own cache
+    // line so thieves probing it don't slow the owner down.
+    _Alignas(CACHE_LINE) _Atomic uint64_t range;
+    char pad[CACHE_LINE - sizeof(uint64_t)];
+
+    Runner *runner;
+    int index;
+    pthread_t thread;
+    bool started; // false if its thread couldn't be made, others steal its range
+    uint64_t steals;
+    uint64_t events; // --events only
+    CellStats *stats; // one per cell, only touched by this worker
+} Worker;
+
+static uint64_t packRange(uint32_t begin, uint32_t end) {
+    return (uint64_t)end << 32 | begin;
+}
+
+static float sweepValue(const Sweep *sweep, int i) {
+    if(sweep->count <= 1) return sweep->min;
+    return sweep->min + (sweep->max - sweep->min)*i/(sweep->count - 1);
+}
+
+static SimConfig cellConfig(const Runner *r, int cell) {
+    SimConfig config = r->base;
+    float values[SWEEP_COUNT];
+    for(int s = 0; s < SWEEP_COUNT; ++s) {
+        values[s] = sweepValue(&r->sweeps[s], cell % r->sweeps[s].count);
+        cell /= r->sweeps[s].count;
+    }
+    config.gravity = values[SWEEP_GRAVITY];
+    config.jumpForce = values[SWEEP_JUMP_FORCE];
+    config.gapSize = values[SWEEP_GAP_SIZE];
+    config.pipeSpacing = values[SWEEP_PIPE_SPACING];
+    return config;
+}
+
+// jump when the bird drops below the middle of the next gap
+static bool heuristicJump(const SimBatch *b, int i) {
+    const SimConfig *c = &b->config;
+    float birdX = c->screenWidth/2.0f;
+    float left = birdX - c->birdWidth*c->hitShrink/2;
+
+    float nextX = INFINITY;
+    float target = c->screenHeight/2;
+    for(int p = 0; p < MAX_PIPES; ++p) {
+        float x = b->pipeX[p][i];
+        if(x + c->pipeWidth >= left && x < nextX) {
+            nextX = x;
+            target = b->gapY[p][i];
+        }
+    }
+    return b->birdY[i] > target + c->gapSize/8 && b->birdVel[i] >= 0.0f;
+}
+
+static void runChunk(Worker *w, uint64_t chunk, SimBatch *batch, uint8_t *jump, uint64_t *policySeed) {
+    Runner *r = w->runner;
+    int cell = (int)(chunk/r->chunksPerCell);
+    uint64_t first = (chunk % r->chunksPerCell)*CHUNK_EPISODES;
+    int count = (int)((r->episodes - first) < CHUNK_EPISODES ? (r->episodes - first) : CHUNK_EPISODES);
+
+    batch->config = cellConfig(r, cell);
+    for(int i = 0; i < batch->capacity; ++i) {
+        if(i < count) {
+            // every episode gets its own stream for pipes and one for the policy
+            uint64_t seed = rngAt(r->seed, (uint64_t)cell << 40 | (first + i));
+            simBatchReset(batch, i, seed);
+            policySeed[i] = rngMix64(seed);
+        } else {
+            batch->alive[i] = 0;
+        }
+    }
+
+    int running = count;
+    uint32_t tick = 0;
+    while(running > 0 && tick < r->maxTicks) {
+        for(int i = 0; i < count; ++i) {
+            if(!batch->alive[i]) { jump[i] = 0; continue; }
+            switch(r->policy) {
+                case POLICY_HEURISTIC: jump[i] = heuristicJump(batch, i); break;
+                case POLICY_RANDOM: jump[i] = (rngAt(policySeed[i], tick) & 31) == 0; break;
+                default: jump[i] = 0; break;
+            }
+        }
+
+        simBatchStep(batch, jump, SIM_TICK_DT, NULL);
+        ++tick;
+
+        running = 0;
+        for(int i = 0; i < count; ++i) running += batch->alive[i] != 0;
+    }
+
+    CellStats *s = &w->stats[cell];
+    for(int i = 0; i < count; ++i) {
+        int score = batch->score[i];
+        s->episodes++;
+        s->truncated += batch->alive[i] != 0;
+        s->ticks += batch->tick[i];
+        s->scoreSum += score;
+        s->scoreSqSum += (double)score*score;
+        if(score > s->maxScore) s->maxScore = score;
+    }
+}
+
+/* Event driven */
+
+typedef struct EventPolicy {
+    Policy policy;
+    uint64_t seed;
+    uint32_t nextTick; // random: the earliest tick it may jump on again
+} EventPolicy;
+
+// heuristicJump ahead of time: the bird drops below the middle of the
+// next gap while falling, or the pipe clears the bird and it takes
+// another look at the one after
+static float heuristicWait(const SimWorld *world, bool *jump) {
+    const SimConfig *c = &world->config;
+    float left = world->birdX - c->birdWidth*c->hitShrink/2;
+
+    float target = c->screenHeight/2;
+    double clear = -1.0;
+    uint32_t first;
+    if(simPipesInSpan(world, left, INFINITY, &first)) {
+        uint32_t i = simPipeSlot(world, first);
+        target = world->gapY[i];
+        if(c->pipeSpeed > 0) clear = (world->pipeX[i] + c->pipeWidth - left)/c->pipeSpeed;
+    }
+
+    double y = world->birdY - (target + c->gapSize/8);
+    double v = world->birdVel, g = c->gravity;
+    double drop = -1.0;
+    if(y > 0 && v >= 0) {
+        drop = 0.0;
+    } else if(g > 0) {
+        // below it all the way up, jump at the top
+        double d = v*v - 2*g*y;
+        if(d < 0) drop = -v/g;
+        // else the later root of y + v t + g t^2/2 = 0, on the way down
+        else drop = (-v + sqrt(d))/g;
+    }
+
+    if(drop >= 0 && (clear < 0 || drop <= clear)) {
+        *jump = true;
+        return (float)drop;
+    }
+    return (float)clear;
+}
+
+// the random policy's ticks, found ahead of time
+static float randomWait(const SimWorld *world, EventPolicy *p, bool *jump) {
+    uint32_t tick = world->tick > p->nextTick ? world->tick : p->nextTick;
+    for(uint32_t k = tick; k < tick + 4096; ++k) {
+        if((rngAt(p->seed, k) & 31) == 0) {
+            p->nextTick = k + 1;
+            *jump = true;
+            return (float)((double)(k - world->tick)/SIM_TICK_RATE);
+        }
+    }
+    return -1.0f;
+}
+
+static float eventPolicy(const SimWorld *world, void *user, bool *jump) {
+    EventPolicy *p = user;
+    switch(p->policy) {
+        case POLICY_HEURISTIC: return heuristicWait(world, jump);
+        case POLICY_RANDOM: return randomWait(world, p, jump);
+        default: return -1.0f;
+    }
+}
+
+static void runChunkEvents(Worker *w, uint64_t chunk) {
+    Runner *r = w->runner;
+    int cell = (int)(chunk/r->chunksPerCell);
+    uint64_t first = (chunk % r->chunksPerCell)*CHUNK_EPISODES;
+    int count = (int)((r->episodes - first) < CHUNK_EPISODES ? (r->episodes - first) : CHUNK_EPISODES);
+
+    SimConfig config = cellConfig(r, cell);
+    CellStats *s = &w->stats[cell];
+    for(int i = 0; i < count; ++i) {
+        uint64_t seed = rngAt(r->seed, (uint64_t)cell << 40 | (first + i));
+        SimWorld world;
+        simInit(&world, &config, seed);
+        EventPolicy policy = {r->policy, rngMix64(seed), 0};
+        w->events += simRunEvents(&world, eventPolicy, &policy, (float)r->maxTicks/SIM_TICK_RATE);
+
+        int score = world.score;
+        s->episodes++;
+        s->truncated += !world.gameOver;
+        s->ticks += world.tick;
+        s->scoreSum += score;
+        s->scoreSqSum += (double)score*score;
+        if(score > s->maxScore) s->maxScore = score;
+    }
+}
+
+static bool popOwn(Worker *w, uint64_t *chunk) {
+    uint64_t r = atomic_load_explicit(&w->range, memory_order_acquire);
+    for(;;) {
+        uint32_t begin = (uint32_t)r, end = (uint32_t)(r >> 32);
+        if(begin >= end) return false;
+        if(atomic_compare_exchange_weak_explicit(&w->range, &r, packRange(begin + 1, end),
+                                                 memory_order_acq_rel, memory_order_acquire)) {
+            *chunk = begin;
+            return true;
+        }
+    }
+}
+
+// take the back half of another worker's range
+static bool steal(Worker *w, uint64_t *chunk) {
+    Runner *r = w->runner;
+    for(int k = 1; k < r->threadCount; ++k) {
+        Worker *victim = &r->workers[(w->index + k) % r->threadCount];
+        uint64_t v = atomic_load_explicit(&victim->range, memory_order_acquire);
+        for(;;) {
+            uint32_t begin = (uint32_t)v, end = (uint32_t)(v >> 32);
+            if(begin >= end) break;
+            uint32_t mid = begin + (end - begin)/2;
+            if(atomic_compare_exchange_weak_explicit(&victim->range, &v, packRange(begin, mid),
+                                                     memory_order_acq_rel, memory_order_acquire)) {
+                // our own range is empty, nobody else can be updating it
+                atomic_store_explicit(&w->range, packRange(mid + 1, end), memory_order_release);
+                *chunk = mid;
+                w->steals++;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void *workerMain(void *arg) {
+    Worker *w = arg;
+    SimBatch batch;
+    if(!simBatchInit(&batch, &w->runner->base, CHUNK_EPISODES)) return NULL;
+
+    uint8_t jump[CHUNK_EPISODES] = {0};
+    uint64_t policySeed[CHUNK_EPISODES];
+
+    uint64_t chunk;
+    while(popOwn(w, &chunk) || steal(w, &chunk)) {
+        if(w->runner->events) runChunkEvents(w, chunk);
+        else runChunk(w, chunk, &batch, jump, policySeed);
+    }
+
+    simBatchFree(&batch);
+    return NULL;
+}
+
+static bool parseSweep(Sweep *sweep, const char *text) {
+    float min, max;
+    int count;
+    if(sscanf(text, "%f:%f:%d", &min, &max, &count) == 3 && count > 0) {
+        sweep->min = min;
+        sweep->max = max;
+        sweep->count = count;
+        return true;
+    }
+    if(sscanf(text, "%f", &min) == 1) {
+        sweep->min = sweep->max = min;
+        sweep->count = 1;
+        return true;
+    }
+    return false;
+}
+
+static void usage(const char *exe) {
+    fprintf(stderr,
+        "usage: %s [options]\n"
+        "  --episodes N        episodes per grid point (default 10000)\n"
+        "  --threads N         worker threads (default: all cores)\n"
+        "  --seed N            base seed (default 1)\n"
+        "  --policy NAME       heuristic | random | idle (default heuristic)\n"
+        "  --max-seconds S     cut episodes off after S simulated seconds (default 600)\n"
+        "  --events            skip from event to event instead of ticking\n"
+        "  --gravity A[:B:N]   sweep GRAVITY from A to B in N steps\n"
+        "  --jump-force A[:B:N]\n"
+        "  --gap-size A[:B:N]\n"
+        "  --pipe-spacing A[:B:N]\n", exe);
+}
+
+static double now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+int main(int argc, char **argv) {
+    Runner r;
+    memset(&r, 0, sizeof(r));
+    r.base = simDefaultConfig();
+    r.episodes = 10000;
+    r.seed = 1;
+    r.maxTicks = 600*SIM_TICK_RATE;
+    r.policy = POLICY_HEURISTIC;
+
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    r.threadCount = cores > 0 ? (int)cores : 1;
+
+    r.sweeps[SWEEP_GRAVITY] = (Sweep){"gravity", r.base.gravity, r.base.gravity, 1};
+    r.sweeps[SWEEP_JUMP_FORCE] = (Sweep){"jumpForce", r.base.jumpForce, r.base.jumpForce, 1};
+    r.sweeps[SWEEP_GAP_SIZE] = (Sweep){"gapSize", r.base.gapSize, r.base.gapSize, 1};
+    r.sweeps[SWEEP_PIPE_SPACING] = (Sweep){"pipeSpacing", r.base.pipeSpacing, r.base.pipeSpacing, 1};
+
+    for(int i = 1; i < argc; ++i) {
+        const char *arg = argv[i];
+        const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+        bool ok = value != NULL;
+
+        if(strcmp(arg, "--events") == 0) {
+            r.events = true;
+            continue;
+        }
+
+        if(strcmp(arg, "--episodes") == 0 && ok) r.episodes = strtoull(value, NULL, 10);
+        else if(strcmp(arg, "--threads") == 0 && ok) r.threadCount = atoi(value);
+        else if(strcmp(arg, "--seed") == 0 && ok) r.seed = strtoull(value, NULL, 10);
+        else if(strcmp(arg, "--max-seconds") == 0 && ok) r.maxTicks = (uint32_t)(atof(value)*SIM_TICK_RATE);
+        else if(strcmp(arg, "--policy") == 0 && ok) {
+            if(strcmp(value, "heuristic") == 0) r.policy = POLICY_HEURISTIC;
+            else if(strcmp(value, "random") == 0) r.policy = POLICY_RANDOM;
+            else if(strcmp(value, "idle") == 0) r.policy = POLICY_IDLE;
+            else ok = false;
+        }
+        else if(strcmp(arg, "--gravity") == 0 && ok) ok = parseSweep(&r.sweeps[SWEEP_GRAVITY], value);
+        else if(strcmp(arg, "--jump-force") == 0 && ok) ok = parseSweep(&r.sweeps[SWEEP_JUMP_FORCE], value);
+        else if(strcmp(arg, "--gap-size") == 0 && ok) ok = parseSweep(&r.sweeps[SWEEP_GAP_SIZE], value);
+        else if(strcmp(arg, "--pipe-spacing") == 0 && ok) ok = parseSweep(&r.sweeps[SWEEP_PIPE_SPACING], value);
+        else ok = false;
+
+        if(!ok) {
+            usage(argv[0]);
+            return 1;
+        }
+        ++i;
+    }
+
+    if(r.threadCount < 1) r.threadCount = 1;
+    if(r.episodes == 0) r.episodes = 1;
+
+    r.cells = 1;
+    for(int s = 0; s < SWEEP_COUNT; ++s) r.cells *= r.sweeps[s].count;
+
+    r.chunksPerCell = (r.episodes + CHUNK_EPISODES - 1)/CHUNK_EPISODES;
+    uint64_t chunks = r.chunksPerCell*r.cells;
+    if(chunks > UINT32_MAX) {
+        fprintf(stderr, "too many episodes: %llu chunks\n", (unsigned long long)chunks);
+        return 1;
+    }
+
+    r.workers = aligned_alloc(CACHE_LINE, sizeof(Worker)*r.threadCount);
+    if(r.workers == NULL) return 1;
+
+    for(int t = 0; t < r.threadCount; ++t) {
+        Worker *w = &r.workers[t];
+        memset(w, 0, sizeof(*w));
+        w->runner = &r;
+        w->index = t;
+        w->stats = calloc(r.cells, sizeof(CellStats));
+        if(w->stats == NULL) return 1;
+
+        uint32_t begin = (uint32_t)(chunks*t/r.threadCount);
+        uint32_t end = (uint32_t)(chunks*(t + 1)/r.threadCount);
+        atomic_init(&w->range, packRange(begin, end));
+    }
+
+    double start = now();
+    int started = 1;
+    for(int t = 1; t < r.threadCount; ++t) {
+        r.workers[t].started = pthread_create(&r.workers[t].thread, NULL, workerMain, &r.workers[t]) == 0;
+        started += r.workers[t].started;
+    }
+    if(started < r.threadCount) fprintf(stderr, "only %d of %d threads started, the rest is stolen\n", started, r.threadCount);
+    workerMain(&r.workers[0]);
+    for(int t = 1; t < r.threadCount; ++t) {
+        if(r.workers[t].started) pthread_join(r.workers[t].thread, NULL);
+    }
+    double elapsed = now() - start;
+
+    // merge per worker results
+    uint64_t totalEpisodes = 0, totalTicks = 0, totalSteals = 0, totalEvents = 0;
+    printf("gravity,jumpForce,gapSize,pipeSpacing,episodes,meanScore,stddevScore,maxScore,meanSeconds,truncated\n");
+    for(int cell = 0; cell < r.cells; ++cell) {
+        CellStats sum = {0};
+        for(int t = 0; t < r.threadCount; ++t) {
+            const CellStats *s = &r.workers[t].stats[cell];
+            sum.episodes += s->episodes;
+            sum.truncated += s->truncated;
+            sum.ticks += s->ticks;
+            sum.scoreSum += s->scoreSum;
+            sum.scoreSqSum += s->scoreSqSum;
+            if(s->maxScore > sum.maxScore) sum.maxScore = s->maxScore;
+        }
+
+        double n = sum.episodes ? (double)sum.episodes : 1.0;
+        double mean = sum.scoreSum/n;
+        double variance = sum.scoreSqSum/n - mean*mean;
+        SimConfig c = cellConfig(&r, cell);
+        printf("%g,%g,%g,%g,%llu,%.4f,%.4f,%d,%.3f,%llu\n",
+               c.gravity, c.jumpForce, c.gapSize, c.pipeSpacing,
+               (unsigned long long)sum.episodes, mean, variance > 0 ? sqrt(variance) : 0.0,
+               sum.maxScore, (double)sum.ticks/n/SIM_TICK_RATE, (unsigned long long)sum.truncated);
+
+        totalEpisodes += sum.episodes;
+        totalTicks += sum.ticks;
+    }
+    for(int t = 0; t < r.threadCount; ++t) {
+        totalSteals += r.workers[t].steals;
+        totalEvents += r.workers[t].events;
+        free(r.workers[t].stats);
+    }
+    free(r.workers);
+
+    fprintf(stderr, "%llu episodes, %llu ticks in %.3f s on %d threads (%.1f M ticks/s, %llu steals)\n",
+            (unsigned long long)totalEpisodes, (unsigned long long)totalTicks, elapsed, r.threadCount,
+            totalTicks/elapsed*1e-6, (unsigned long long)totalSteals);
+    if(r.events) {
+        fprintf(stderr, "%llu events, %.1f ticks each\n", (unsigned long long)totalEvents,
+                totalEvents ? (double)totalTicks/totalEvents : 0.0);
+    }
+    return 0;
+}
@@ -0,0 +1,507 @@
+#include "sim.h"
+#include "bits.h"
+#include "rng.h"
+
+#include <math.h>
+#include <stddef.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PIPE_LANES 4
+#endif
+
+SimConfig simDefaultConfig(void) {
+    SimConfig config;
+    config.screenWidth = 1400.0f;
+    config.screenHeight = 720.0f;
+
+    config.gravity = GRAVITY;
+    config.jumpForce = JUMP_FORCE;
+
+    config.pipeWidth = 120.0f;
+    config.gapSize = 250.0f;
+    config.pipeSpeed = 200.0f;
+    config.pipeSpacing = 320.0f;
+
+    // size of assets/sprites/bird.png
+    config.birdWidth = 64.0f;
+    config.birdHeight = 64.0f;
+    config.hitShrink = 0.3f;
+
+    config.birdMask = NULL;
+    config.pipeMask = NULL;
+    config.course = NULL;
+    return config;
+}
+
+float simPipeGap(const SimConfig *config, uint64_t seed, uint32_t pipeIndex) {
+    int min = config->gapSize/2 + 30;
+    int max = config->screenHeight - config->gapSize/2 - 30;
+    return rngRangeAt(seed, pipeIndex, min, max);
+}
+
+#if !defined(PIPE_LANES)
+static bool overlaps(float ax, float ay, float aw, float ah, float bx, float by, float bw, float bh) {
+    return ax < bx + bw && ax + aw > bx && ay < by + bh && ay + ah > by;
+}
+#endif
+
+static void pushPipe(SimWorld *world, float x, float gapY) {
+    uint32_t i = simPipeSlot(world, world->pipeCount++);
+    world->pipeX[i] = x;
+    world->gapY[i] = gapY;
+    world->pipeId[i] = world->pipesSpawned++;
+}
+
+// course obstacles join the ring as they reach the right edge of the screen
+static void spawnCourse(SimWorld *world) {
+    const SimConfig *c = &world->config;
+    const SimCourse *course = c->course;
+    while(world->pipesSpawned < course->count && world->pipeCount < SIM_PIPE_RING) {
+        const SimObstacle *o = &course->obstacles[world->pipesSpawned];
+        float x = (float)(o->x - world->scroll);
+        if(x > c->screenWidth) break;
+        pushPipe(world, x, o->gapY);
+    }
+}
+
+void simInit(SimWorld *world, const SimConfig *config, uint64_t seed) {
+    world->config = *config;
+    simReset(world, seed);
+}
+
+void simReset(SimWorld *world, uint64_t seed) {
+    const SimConfig *c = &world->config;
+
+    world->birdX = c->screenWidth/2.0f;
+    world->birdY = c->screenHeight/2.0f - 100;
+    world->birdVel = 0.0f;
+    world->score = 0;
+    world->gameOver = false;
+    world->tick = 0;
+    world->seed = seed;
+    world->pipesSpawned = 0;
+    world->scroll = 0.0;
+
+    world->pipeHead = 0;
+    world->pipeCount = 0;
+    world->nextScore = 0;
+    if(c->course) {
+        spawnCourse(world);
+    } else {
+        for(int i = 0; i < MAX_PIPES; ++i) pushPipe(world, c->screenWidth + i*c->pipeSpacing, simPipeGap(c, seed, world->pipesSpawned));
+    }
+}
+
+uint32_t simPipesInSpan(const SimWorld *world, float x0, float x1, uint32_t *first) {
+    float pipeWidth = world->config.pipeWidth;
+
+    // every pipe is as wide, so the right edges are sorted too
+    uint32_t k = 0;
+    while(k < world->pipeCount && world->pipeX[simPipeSlot(world, k)] + pipeWidth <= x0) ++k;
+    uint32_t end = k;
+    while(end < world->pipeCount && world->pipeX[simPipeSlot(world, end)] < x1) ++end;
+
+    *first = k;
+    return end - k;
+}
+
+// Second stage, the boxes already overlap
+static bool pixelsHit(const SimWorld *world, uint32_t i) {
+    const SimConfig *c = &world->config;
+    if(c->birdMask == NULL || c->pipeMask == NULL) return true;
+    return simMaskHitsPipe(c, world->birdX, world->birdY, world->pipeX[i], world->gapY[i]);
+}
+
+// The hit box against both halves of count pipes from ring position first.
+// Same comparisons as overlaps(), four pipes at a time with SSE.
+static bool hitsPipes(const SimWorld *world, float x, float y, float w, float h, uint32_t first, uint32_t count) {
+    const SimConfig *c = &world->config;
+
+#if defined(PIPE_LANES)
+    const __m128 left = _mm_set1_ps(x), right = _mm_set1_ps(x + w);
+    const __m128 top = _mm_set1_ps(y), bottom = _mm_set1_ps(y + h);
+    const __m128 pipeWidth = _mm_set1_ps(c->pipeWidth);
+    const __m128 halfGap = _mm_set1_ps(c->gapSize/2);
+    const __m128 screenHeight = _mm_set1_ps(c->screenHeight);
+    const __m128 zero = _mm_setzero_ps();
+
+    for(uint32_t k = 0; k < count; k += PIPE_LANES) {
+        uint32_t lanes = count - k < PIPE_LANES ? count - k : PIPE_LANES;
+        float px[PIPE_LANES] = {0}, gy[PIPE_LANES] = {0};
+        for(uint32_t l = 0; l < lanes; ++l) {
+            uint32_t i = simPipeSlot(world, first + k + l);
+            px[l] = world->pipeX[i];
+            gy[l] = world->gapY[i];
+        }
+
+        __m128 pipeX = _mm_loadu_ps(px);
+        __m128 gap = _mm_loadu_ps(gy);
+        __m128 gapTop = _mm_sub_ps(gap, halfGap);
+        __m128 gapBottom = _mm_add_ps(gap, halfGap);
+
+        __m128 overlapX = _mm_and_ps(_mm_cmplt_ps(left, _mm_add_ps(pipeX, pipeWidth)), _mm_cmpgt_ps(right, pipeX));
+        __m128 upper = _mm_and_ps(_mm_cmplt_ps(top, gapTop), _mm_cmpgt_ps(bottom, zero));
+        __m128 lower = _mm_and_ps(_mm_cmplt_ps(top, _mm_add_ps(gapBottom, _mm_sub_ps(screenHeight, gapBottom))),
+                                  _mm_cmpgt_ps(bottom, gapBottom));
+        int hit = _mm_movemask_ps(_mm_and_ps(overlapX, _mm_or_ps(upper, lower))) & ((1 << lanes) - 1);
+        for(; hit; hit &= hit - 1) {
+            if(pixelsHit(world, simPipeSlot(world, first + k + lowestBit(hit)))) return true;
+        }
+    }
+#else
+    for(uint32_t k = 0; k < count; ++k) {
+        uint32_t i = simPipeSlot(world, first + k);
+        float gapTop = world->gapY[i] - c->gapSize/2;
+        float gapBottom = world->gapY[i] + c->gapSize/2;
+
+        if((overlaps(x, y, w, h, world->pipeX[i], 0, c->pipeWidth, gapTop) ||
+            overlaps(x, y, w, h, world->pipeX[i], gapBottom, c->pipeWidth, c->screenHeight - gapBottom)) &&
+           pixelsHit(world, i)) {
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
+bool simCheckCollision(const SimWorld *world) {
+    const SimConfig *c = &world->config;
+    const SimMask *mask = c->birdMask;
+
+    float x, y, w, h;
+    if(mask && c->pipeMask) {
+        // the bird's solid pixels, on whole pixels like it's drawn, for the
+        // screen edges as well
+        x = floorf(world->birdX - mask->width/2.0f) + mask->left;
+        y = floorf(world->birdY - mask->height/2.0f) + mask->top;
+        w = mask->right - mask->left;
+        h = mask->bottom - mask->top;
+        if(y + h >= c->screenHeight || y <= 0) return true;
+    } else {
+        // collision of top and bottom of our screen
+        if(world->birdY + c->birdHeight/2 >= c->screenHeight || world->birdY - c->birdHeight/2 <= 0) return true;
+
+        // Check collision within the pipe
+        w = c->birdWidth*c->hitShrink;
+        h = c->birdHeight*c->hitShrink;
+        x = world->birdX - w/2;
+        y = world->birdY - h/2;
+    }
+
+    // only the pipes level with the bird can touch it
+    uint32_t first;
+    uint32_t count = simPipesInSpan(world, x, x + w, &first);
+    return hitsPipes(world, x, y, w, h, first, count);
+}
+
+static void movePipes(SimWorld *world, float distance) {
+    for(uint32_t k = 0; k < world->pipeCount; ++k) world->pipeX[simPipeSlot(world, k)] -= distance;
+    if(world->config.course) world->scroll += distance;
+}
+
+// retires pipes that left the screen and brings in the next ones
+static void cyclePipes(SimWorld *world) {
+    const SimConfig *c = &world->config;
+
+    // the leftmost pipe is always the next to leave
+    while(world->pipeCount > 0 && world->pipeX[world->pipeHead] + c->pipeWidth <= 0) {
+        world->pipeHead = simPipeSlot(world, 1);
+        --world->pipeCount;
+        if(c->course == NULL) pushPipe(world, c->screenWidth, simPipeGap(c, world->seed, world->pipesSpawned));
+    }
+    if(c->course) spawnCourse(world);
+}
+
+// score logic, pipes are passed left to right
+static int scorePipes(SimWorld *world) {
+    const SimConfig *c = &world->config;
+    int events = 0;
+    if(world->pipeCount == 0) return events;
+
+    uint32_t headId = world->pipeId[world->pipeHead];
+    uint32_t k = world->nextScore > headId ? world->nextScore - headId : 0;
+    for(; k < world->pipeCount; ++k) {
+        if(!(world->birdX > world->pipeX[simPipeSlot(world, k)] + c->pipeWidth)) break;
+        ++world->score;
+        world->nextScore = world->pipeId[simPipeSlot(world, k)] + 1;
+        events |= SIM_EVENT_SCORE;
+    }
+    return events;
+}
+
+int simStep(SimWorld *world, SimInput input, float dt) {
+    const SimConfig *c = &world->config;
+    int events = 0;
+
+    if(world->gameOver) return events;
+
+    if(input.jump) {
+        world->birdVel = c->jumpForce;
+        events |= SIM_EVENT_JUMP;
+    }
+
+    // for bird gavity
+    world->birdVel += c->gravity*dt;
+    world->birdY += world->birdVel*dt;
+
+    // for pipe
+    movePipes(world, c->pipeSpeed*dt);
+    cyclePipes(world);
+
+    if(simCheckCollision(world)) {
+        world->gameOver = true;
+        events |= SIM_EVENT_DEATH;
+    }
+
+    events |= scorePipes(world);
+
+    ++world->tick;
+    return events;
+}
+
+/* Swept */
+
+// The bird's box around its centre: x span on screen, rows against the
+// pipes and rows against the screen edges
+typedef struct HitBox {
+    float left, right;
+    float top, bottom;
+    float edgeTop, edgeBottom;
+} HitBox;
+
+static HitBox hitBox(const SimWorld *world) {
+    const SimConfig *c = &world->config;
+    const SimMask *mask = c->birdMask;
+    HitBox box;
+
+    if(mask && c->pipeMask) {
+        // the solid pixels as a box, sweeping doesn't go down to pixels
+        box.left = floorf(world->birdX - mask->width/2.0f) + mask->left;
+        box.right = box.left + (mask->right - mask->left);
+        box.top = box.edgeTop = mask->top - mask->height/2.0f;
+        box.bottom = box.edgeBottom = mask->bottom - mask->height/2.0f;
+    } else {
+        float w = c->birdWidth*c->hitShrink;
+        float h = c->birdHeight*c->hitShrink;
+        box.left = world->birdX - w/2;
+        box.right = box.left + w;
+        box.top = -h/2;
+        box.bottom = h/2;
+        box.edgeTop = -c->birdHeight/2;
+        box.edgeBottom = c->birdHeight/2;
+    }
+    return box;
+}
+
+// Smallest root of a*t^2 + b*t + c in (t0, t1], INFINITY if there's none
+static double firstRoot(double a, double b, double c, double t0, double t1) {
+    double roots[2];
+    int count = 0;
+    if(a == 0.0) {
+        if(b != 0.0) roots[count++] = -c/b;
+    } else {
+        double d = b*b - 4*a*c;
+        if(d < 0.0) return INFINITY;
+        // the stable form, no cancellation when b dominates
+        double q = -0.5*(b + copysign(sqrt(d), b));
+        roots[count++] = q/a;
+        if(q != 0.0) roots[count++] = c/q;
+    }
+
+    double first = INFINITY;
+    for(int i = 0; i < count; ++i) {
+        if(roots[i] > t0 && roots[i] <= t1 && roots[i] < first) first = roots[i];
+    }
+    return first;
+}
+
+// First t in t0..t1 where y + v*t + g*t^2/2 reaches lo or hi, INFINITY if
+// it stays between them
+static double leaveBand(double y, double v, double g, double lo, double hi, double t0, double t1) {
+    double y0 = y + v*t0 + 0.5*g*t0*t0;
+    if(y0 <= lo || y0 >= hi) return t0;
+
+    double low = firstRoot(0.5*g, v, y - lo, t0, t1);
+    double high = firstRoot(0.5*g, v, y - hi, t0, t1);
+    return low < high ? low : high;
+}
+
+float simTimeOfImpact(const SimWorld *world, float dt) {
+    const SimConfig *c = &world->config;
+    HitBox box = hitBox(world);
+    double y = world->birdY, v = world->birdVel, g = c->gravity;
+
+    // collision of top and bottom of our screen, the whole way
+    double first = leaveBand(y, v, g, -box.edgeTop, c->screenHeight - box.edgeBottom, 0.0, dt);
+
+    // each pipe while it's level with the bird
+    for(uint32_t k = 0; k < world->pipeCount; ++k) {
+        uint32_t i = simPipeSlot(world, k);
+        double x = world->pipeX[i];
+        double enter = 0.0, leave = dt;
+        if(c->pipeSpeed > 0) {
+            enter = (x - box.right)/c->pipeSpeed;
+            leave = (x + c->pipeWidth - box.left)/c->pipeSpeed;
+        } else if(!(box.left < x + c->pipeWidth && box.right > x)) {
+            continue;
+        }
+        // the rest arrive later still
+        if(enter >= first) break;
+        if(enter < 0.0) enter = 0.0;
+        if(leave > first) leave = first;
+        if(leave < enter) continue;
+
+        double gapTop = world->gapY[i] - c->gapSize/2;
+        double gapBottom = world->gapY[i] + c->gapSize/2;
+        double hit = leaveBand(y, v, g, gapTop - box.top, gapBottom - box.bottom, enter, leave);
+        if(hit < first) first = hit;
+    }
+    return first <= dt ? (float)first : -1.0f;
+}
+
+// Seconds until a pipe leaves the screen or a course obstacle comes on.
+// At least a microsecond, so rounding can't stall a sweep.
+static double nextCycle(const SimWorld *world) {
+    const SimConfig *c = &world->config;
+    if(c->pipeSpeed <= 0) return INFINITY;
+
+    double next = INFINITY;
+    if(world->pipeCount > 0) next = (world->pipeX[world->pipeHead] + c->pipeWidth)/c->pipeSpeed;
+    if(c->course && world->pipesSpawned < c->course->count && world->pipeCount < SIM_PIPE_RING) {
+        double spawn = (c->course->obstacles[world->pipesSpawned].x - world->scroll - c->screenWidth)/c->pipeSpeed;
+        if(spawn < next) next = spawn;
+    }
+    return next < 1e-6 ? 1e-6 : next;
+}
+
+int simStepSwept(SimWorld *world, SimInput input, float dt) {
+    const SimConfig *c = &world->config;
+    int events = 0;
+
+    if(world->gameOver) return events;
+
+    if(input.jump) {
+        world->birdVel = c->jumpForce;
+        events |= SIM_EVENT_JUMP;
+    }
+
+    // pipes only come and go at the screen edges, in between the ring is
+    // fixed and one sweep covers it
+    double left = dt;
+    while(left > 0.0) {
+        double span = nextCycle(world);
+        if(span > left) span = left;
+        float hit = simTimeOfImpact(world, (float)span);
+        double t = hit >= 0.0f ? hit : span;
+
+        world->birdY = (float)(world->birdY + world->birdVel*t + 0.5*c->gravity*t*t);
+        world->birdVel = (float)(world->birdVel + c->gravity*t);
+        movePipes(world, (float)(c->pipeSpeed*t));
+        events |= scorePipes(world);
+        cyclePipes(world);
+
+        if(hit >= 0.0f) {
+            world->gameOver = true;
+            events |= SIM_EVENT_DEATH;
+            break;
+        }
+        left -= span;
+    }
+
+    ++world->tick;
+    return events;
+}
+
+/* Event driven */
+
+float simNextEvent(const SimWorld *world) {
+    const SimConfig *c = &world->config;
+    double next = nextCycle(world);
+
+    // the first pipe the bird hasn't passed
+    if(c->pipeSpeed > 0 && world->pipeCount > 0) {
+        uint32_t headId = world->pipeId[world->pipeHead];
+        uint32_t k = world->nextScore > headId ? world->nextScore - headId : 0;
+        if(k < world->pipeCount) {
+            double pass = (world->pipeX[simPipeSlot(world, k)] + c->pipeWidth - world->birdX)/c->pipeSpeed;
+            if(pass < 1e-6) pass = 1e-6;
+            if(pass < next) next = pass;
+        }
+    }
+
+    float hit = simTimeOfImpact(world, (float)next);
+    if(hit >= 0.0f) next = hit < 1e-6f ? 1e-6 : hit;
+    return (float)next;
+}
+
+uint32_t simRunEvents(SimWorld *world, SimPolicy policy, void *user, float maxSeconds) {
+    uint32_t startTick = world->tick;
+    uint32_t steps = 0;
+    double elapsed = 0.0;
+    bool jumped = false;
+
+    while(!world->gameOver && elapsed < maxSeconds) {
+        bool jump = false;
+        float wait = policy(world, user, &jump);
+        // jumping again on the spot changes nothing
+        if(jump && wait <= 0.0f && jumped) wait = -1.0f;
+
+        double step = simNextEvent(world);
+        if(wait >= 0.0f && wait <= step) {
+            step = wait;
+            // only looking again, time has to pass for that
+            if(!jump && step < 1e-6) step = 1e-6;
+        } else {
+            jump = false;
+        }
+        if(step > maxSeconds - elapsed) {
+            step = maxSeconds - elapsed;
+            jump = false;
+        }
+
+        if(step > 0.0) simStepSwept(world, (SimInput){false}, (float)step);
+        if(jump && !world->gameOver) simStepSwept(world, (SimInput){true}, 0.0f);
+        jumped = jump;
+        elapsed += step;
+        ++steps;
+
+        // ticks stand for time here, not calls
+        world->tick = startTick + (uint32_t)(elapsed*SIM_TICK_RATE);
+    }
+    return steps;
+}
+
+int simClockAdvance(SimClock *clock, float frameTime) {
+    if(frameTime > SIM_MAX_FRAME_TIME) frameTime = SIM_MAX_FRAME_TIME;
+    if(frameTime < 0.0f) frameTime = 0.0f;
+
+    clock->accumulator += frameTime;
+
+    int ticks = 0;
+    while(clock->accumulator >= SIM_TICK_DT) {
+        clock->accumulator -= SIM_TICK_DT;
+        ++ticks;
+    }
+    return ticks;
+}
+
+float simClockAlpha(const SimClock *clock) {
+    return clock->accumulator/SIM_TICK_DT;
+}
+
+void simInterpolate(const SimWorld *prev, const SimWorld *cur, float alpha, SimWorld *out) {
+    *out = *cur;
+    out->birdY = prev->birdY + (cur->birdY - prev->birdY)*alpha;
+
+    if(prev->pipeCount == 0) return;
+    uint32_t prevFirst = prev->pipeId[prev->pipeHead];
+    for(uint32_t k = 0; k < cur->pipeCount; ++k) {
+        uint32_t i = simPipeSlot(cur, k);
+        uint32_t j = cur->pipeId[i] - prevFirst;
+        if(cur->pipeId[i] < prevFirst || j >= prev->pipeCount) continue;
+
+        float x = prev->pipeX[simPipeSlot(prev, j)];
+        out->pipeX[i] = x + (cur->pipeX[i] - x)*alpha;
+    }
+}
@@ -0,0 +1,186 @@
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Headless game rules. Nothing in here touches raylib, so the same code
+// runs the windowed game, bots, tools and benchmarks.
+
+// pipes in flight in the endless game
+#define MAX_PIPES 5
+// Pipes a world tracks at once, a power of two. Course obstacles join it as
+// they come on screen, so this bounds how many fit on one screen, not how
+// many a course has.
+#define SIM_PIPE_RING 32
+#define GRAVITY 1000.0f
+#define JUMP_FORCE -375.0f
+
+// Physics runs in fixed ticks so the outcome doesn't depend on frame rate
+#define SIM_TICK_RATE 240
+#define SIM_TICK_DT (1.0f/SIM_TICK_RATE)
+// longest frame we try to catch up on, anything above is dropped
+#define SIM_MAX_FRAME_TIME 0.25f
+
+// Events reported by simStep so the caller can play sounds etc.
+#define SIM_EVENT_JUMP  (1 << 0)
+#define SIM_EVENT_SCORE (1 << 1)
+#define SIM_EVENT_DEATH (1 << 2)
+
+// One obstacle of a fixed course: a pipe pair with its gap centred on gapY.
+// x is where its left edge starts, it scrolls left like any pipe.
+typedef struct SimObstacle {
+    float x;
+    float gapY;
+} SimObstacle;
+
+// Obstacles sorted by x, any number of them. The sim only reads the ones
+// about to come on screen, so a long course costs no more per tick.
+typedef struct SimCourse {
+    const SimObstacle *obstacles;
+    uint32_t count;
+} SimCourse;
+
+// Which pixels of a sprite are solid, 1 bit each. Rows are stride 64-bit
+// words, pixel x is bit x&63 of word x>>6. Built by simMaskBuild.
+typedef struct SimMask {
+    int width, height;
+    int stride;
+    uint64_t *bits;
+    // bounds of the solid pixels, right and bottom exclusive
+    int left, top, right, bottom;
+} SimMask;
+
+typedef struct SimConfig {
+    float screenWidth;
+    float screenHeight;
+
+    float gravity;
+    float jumpForce;
+
+    float pipeWidth;
+    float gapSize;
+    float pipeSpeed;
+    float pipeSpacing;
+
+    // bird sprite size, the pipe hit box is the sprite scaled by hitShrink
+    float birdWidth;
+    float birdHeight;
+    float hitShrink;
+
+    // Pixel collision instead, both or neither. The bird mask is the sprite
+    // as drawn (centred, on whole pixels), the pipe mask is pipeWidth wide
+    // and stretched over each half of a pipe like the sprite. Screen edges
+    // then go by the bird's solid pixels too. Not owned.
+    const SimMask *birdMask;
+    const SimMask *pipeMask;
+
+    // NULL for the endless seeded pipes. Not owned, it must outlive the worlds.
+    const SimCourse *course;
+} SimConfig;
+
+typedef struct SimInput {
+    bool jump;
+} SimInput;
+
+typedef struct SimWorld {
+    SimConfig config;
+
+    float birdX;
+    float birdY;
+    float birdVel; // Y velocity of bird
+
+    // Pipes in a ring sorted by x, the k-th from the left is in slot
+    // simPipeSlot(world, k). Ids are consecutive from left to right.
+    float pipeX[SIM_PIPE_RING]; // Pipe X positions
+    float gapY[SIM_PIPE_RING]; // Gap Y positions
+    uint32_t pipeId[SIM_PIPE_RING]; // spawn order, the obstacle index on a course
+    uint32_t pipeHead;
+    uint32_t pipeCount;
+    uint32_t nextScore; // id of the first pipe the bird hasn't passed
+
+    int score;
+    bool gameOver;
+
+    unsigned int tick;
+
+    // pipe N's gap is simPipeGap(config, seed, N)
+    uint64_t seed;
+    uint32_t pipesSpawned; // on a course, the next obstacle to spawn
+    double scroll; // how far a course has moved, double so long ones stay exact
+} SimWorld;
+
+// Accumulates frame time and hands it out in SIM_TICK_DT steps
+typedef struct SimClock {
+    float accumulator;
+} SimClock;
+
+// Tuning used by the shipped game
+SimConfig simDefaultConfig(void);
+
+void simInit(SimWorld *world, const SimConfig *config, uint64_t seed);
+void simReset(SimWorld *world, uint64_t seed);
+
+// Advance the world by dt seconds, returns a mask of SIM_EVENT_* flags.
+// Does nothing once the bird is dead.
+int simStep(SimWorld *world, SimInput input, float dt);
+
+// simStep for any dt: the bird follows its parabola exactly, pipes come and
+// go along the way and a hit stops the world at the time of impact. For
+// headless runs taking long steps, it agrees with fixed ticks to within
+// their integration error. Counts as one tick.
+int simStepSwept(SimWorld *world, SimInput input, float dt);
+// Seconds into the next dt at which the bird first touches a pipe (of the
+// ones in the ring now) or a screen edge, -1 if it doesn't. Goes by the hit
+// box, with masks the box around the solid pixels.
+float simTimeOfImpact(const SimWorld *world, float dt);
+
+// Seconds until the next thing happens: a pipe passes the bird, leaves
+// the screen or comes on it, the bird hits something. At least a
+// microsecond, INFINITY if nothing ever does.
+float simNextEvent(const SimWorld *world);
+
+// Asked at every event: seconds from now until the policy wants to act
+// (0 for right away), negative for not before the next event. It sets
+// *jump if it jumps then, else it only wants another look.
+typedef float (*SimPolicy)(const SimWorld *world, void *user, bool *jump);
+
+// Plays the world under policy until the bird dies or maxSeconds pass,
+// going straight from one event to the next with simStepSwept, the
+// policy's wishes included. A run costs per event, not per tick. tick
+// follows the time played. Returns how many events there were.
+uint32_t simRunEvents(SimWorld *world, SimPolicy policy, void *user, float maxSeconds);
+
+// Add a frame's worth of time, returns how many fixed ticks to run now
+int simClockAdvance(SimClock *clock, float frameTime);
+// How far we are between the last tick and the next one, 0..1
+float simClockAlpha(const SimClock *clock);
+
+// Blend two consecutive tick states for drawing. Pipes are matched by id,
+// ones that spawned between the two ticks snap to their new position.
+void simInterpolate(const SimWorld *prev, const SimWorld *cur, float alpha, SimWorld *out);
+
+// Gap centre of the pipeIndex-th pipe spawned in a world with this seed.
+// Uniform over the heights that keep the whole gap 30 px inside the screen.
+float simPipeGap(const SimConfig *config, uint64_t seed, uint32_t pipeIndex);
+
+// True if the bird currently overlaps a pipe or the top/bottom of the screen
+bool simCheckCollision(const SimWorld *world);
+
+// Pixels with alpha >= threshold of an RGBA8 image. false if out of memory.
+bool simMaskBuild(SimMask *mask, const uint8_t *rgba, int width, int height, uint8_t threshold);
+void simMaskFree(SimMask *mask);
+// With masks: true if the bird's solid pixels touch the pipe's. Only the
+// rows where their bounds overlap are compared, a word at a time.
+bool simMaskHitsPipe(const SimConfig *config, float birdX, float birdY, float pipeX, float gapY);
+
+static inline uint32_t simPipeSlot(const SimWorld *world, uint32_t k) {
+    return (world->pipeHead + k) & (SIM_PIPE_RING - 1);
+}
+
+// Pipes whose x-span overlaps x0..x1 are ring positions first..first+count-1
+// (for simPipeSlot), returns count. Walks in from the left, so the cost is
+// the pipes before x1, not all of them.
+uint32_t simPipesInSpan(const SimWorld *world, float x0, float x1, uint32_t *first);
+
+#endif
@@ -0,0 +1,336 @@
+#include "simBatch.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bits.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define VEC_WIDTH 8
+typedef __m256 vfloat;
+#define vLoad(p) _mm256_load_ps(p)
+#define vStore(p, v) _mm256_store_ps(p, v)
+#define vLoadMask(p) _mm256_load_ps((const float *)(p))
+#define vStoreMask(p, v) _mm256_store_ps((float *)(p), v)
+#define vSet1(x) _mm256_set1_ps(x)
+#define vAdd(a, b) _mm256_add_ps(a, b)
+#define vSub(a, b) _mm256_sub_ps(a, b)
+#define vMul(a, b) _mm256_mul_ps(a, b)
+#define vLt(a, b) _mm256_cmp_ps(a, b, _CMP_LT_OQ)
+#define vGt(a, b) _mm256_cmp_ps(a, b, _CMP_GT_OQ)
+#define vLe(a, b) _mm256_cmp_ps(a, b, _CMP_LE_OQ)
+#define vGe(a, b) _mm256_cmp_ps(a, b, _CMP_GE_OQ)
+#define vAnd(a, b) _mm256_and_ps(a, b)
+#define vOr(a, b) _mm256_or_ps(a, b)
+#define vAndNot(a, b) _mm256_andnot_ps(a, b) // ~a & b
+#define vSelect(m, a, b) _mm256_blendv_ps(b, a, m)
+#define vMoveMask(v) _mm256_movemask_ps(v)
+#define vFloor(a) _mm256_floor_ps(a)
+// mask lanes are all ones, so subtracting them adds one
+#define vIncrement(p, m) _mm256_store_si256((__m256i *)(p), \
+    _mm256_sub_epi32(_mm256_load_si256((const __m256i *)(p)), _mm256_castps_si256(m)))
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define VEC_WIDTH 4
+typedef __m128 vfloat;
+#define vLoad(p) _mm_load_ps(p)
+#define vStore(p, v) _mm_store_ps(p, v)
+#define vLoadMask(p) _mm_load_ps((const float *)(p))
+#define vStoreMask(p, v) _mm_store_ps((float *)(p), v)
+#define vSet1(x) _mm_set1_ps(x)
+#define vAdd(a, b) _mm_add_ps(a, b)
+#define vSub(a, b) _mm_sub_ps(a, b)
+#define vMul(a, b) _mm_mul_ps(a, b)
+#define vLt(a, b) _mm_cmplt_ps(a, b)
+#define vGt(a, b) _mm_cmpgt_ps(a, b)
+#define vLe(a, b) _mm_cmple_ps(a, b)
+#define vGe(a, b) _mm_cmpge_ps(a, b)
+#define vAnd(a, b) _mm_and_ps(a, b)
+#define vOr(a, b) _mm_or_ps(a, b)
+#define vAndNot(a, b) _mm_andnot_ps(a, b) // ~a & b
+#define vSelect(m, a, b) _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b))
+#define vMoveMask(v) _mm_movemask_ps(v)
+#define vFloor(a) floorSse2(a)
+#define vIncrement(p, m) _mm_store_si128((__m128i *)(p), \
+    _mm_sub_epi32(_mm_load_si128((const __m128i *)(p)), _mm_castps_si128(m)))
+#endif
+
+#define BATCH_ALIGN (SIM_BATCH_LANES*sizeof(float))
+
+#if defined(VEC_WIDTH) && !defined(__AVX2__)
+// SSE2 has no round, truncate and step down where that went up
+static inline __m128 floorSse2(__m128 v) {
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(v));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, v), _mm_set1_ps(1.0f)));
+}
+#endif
+
+static void *batchAlloc(size_t size) {
+#if defined(_WIN32)
+    return _aligned_malloc(size, BATCH_ALIGN);
+#else
+    return aligned_alloc(BATCH_ALIGN, size);
+#endif
+}
+
+static void batchFree(void *p) {
+#if defined(_WIN32)
+    _aligned_free(p);
+#else
+    free(p);
+#endif
+}
+
+bool simBatchInit(SimBatch *batch, const SimConfig *config, int count) {
+    memset(batch, 0, sizeof(*batch));
+    if(count <= 0 || config->course != NULL) return false;
+
+    int capacity = (count + SIM_BATCH_LANES - 1)/SIM_BATCH_LANES*SIM_BATCH_LANES;
+
+    // birdY, birdVel, 3 per pipe, score, alive, tick, pipesSpawned, seed (64 bit)
+    int arrays = 2 + 3*MAX_PIPES + 4 + 2;
+    size_t stride = (size_t)capacity*sizeof(float);
+
+    unsigned char *memory = batchAlloc(stride*arrays);
+    if(memory == NULL) return false;
+    memset(memory, 0, stride*arrays);
+
+    batch->config = *config;
+    batch->count = count;
+    batch->capacity = capacity;
+    batch->memory = memory;
+
+    batch->birdY = (float *)memory; memory += stride;
+    batch->birdVel = (float *)memory; memory += stride;
+    for(int p = 0; p < MAX_PIPES; ++p) {
+        batch->pipeX[p] = (float *)memory; memory += stride;
+        batch->gapY[p] = (float *)memory; memory += stride;
+        batch->scored[p] = (uint32_t *)memory; memory += stride;
+    }
+    batch->score = (int32_t *)memory; memory += stride;
+    batch->alive = (uint32_t *)memory; memory += stride;
+    batch->tick = (uint32_t *)memory; memory += stride;
+    batch->pipesSpawned = (uint32_t *)memory; memory += stride;
+    batch->seed = (uint64_t *)memory;
+
+    for(int i = 0; i < count; ++i) simBatchReset(batch, i, 0);
+    return true;
+}
+
+void simBatchFree(SimBatch *batch) {
+    batchFree(batch->memory);
+    memset(batch, 0, sizeof(*batch));
+}
+
+void simBatchReset(SimBatch *batch, int index, uint64_t seed) {
+    SimWorld world;
+    simInit(&world, &batch->config, seed);
+    simBatchSet(batch, index, &world);
+}
+
+void simBatchSet(SimBatch *batch, int index, const SimWorld *world) {
+    batch->birdY[index] = world->birdY;
+    batch->birdVel[index] = world->birdVel;
+    // endless worlds always have MAX_PIPES in the ring, left to right here
+    for(int p = 0; p < MAX_PIPES; ++p) {
+        uint32_t i = simPipeSlot(world, p);
+        batch->pipeX[p][index] = world->pipeX[i];
+        batch->gapY[p][index] = world->gapY[i];
+        batch->scored[p][index] = world->pipeId[i] < world->nextScore ? ~0u : 0u;
+    }
+    batch->score[index] = world->score;
+    batch->alive[index] = world->gameOver ? 0u : ~0u;
+    batch->tick[index] = world->tick;
+    batch->seed[index] = world->seed;
+    batch->pipesSpawned[index] = world->pipesSpawned;
+}
+
+void simBatchGet(const SimBatch *batch, int index, SimWorld *world) {
+    world->config = batch->config;
+    world->birdX = batch->config.screenWidth/2.0f;
+    world->birdY = batch->birdY[index];
+    world->birdVel = batch->birdVel[index];
+
+    // a respawned pipe keeps its slot and goes to the back, so the slots are
+    // the ring rotated: it starts at the leftmost one
+    int head = 0;
+    for(int p = 1; p < MAX_PIPES; ++p) {
+        if(batch->pipeX[p][index] < batch->pipeX[head][index]) head = p;
+    }
+    uint32_t pipesSpawned = batch->pipesSpawned[index];
+    world->pipeHead = 0;
+    world->pipeCount = MAX_PIPES;
+    world->nextScore = pipesSpawned;
+    for(int k = MAX_PIPES - 1; k >= 0; --k) {
+        int p = (head + k) % MAX_PIPES;
+        world->pipeX[k] = batch->pipeX[p][index];
+        world->gapY[k] = batch->gapY[p][index];
+        world->pipeId[k] = pipesSpawned - MAX_PIPES + k;
+        if(!batch->scored[p][index]) world->nextScore = world->pipeId[k];
+    }
+    world->score = batch->score[index];
+    world->gameOver = batch->alive[index] == 0;
+    world->tick = batch->tick[index];
+    world->seed = batch->seed[index];
+    world->pipesSpawned = pipesSpawned;
+    world->scroll = 0.0;
+}
+
+#if defined(VEC_WIDTH)
+
+// Second stage of pixel collision, for the lanes whose boxes touch pipe p
+static vfloat maskLanes(const SimBatch *batch, int i, int p, vfloat candidates) {
+    const float birdX = batch->config.screenWidth/2.0f;
+    _Alignas(BATCH_ALIGN) uint32_t lanes[VEC_WIDTH] = {0};
+
+    int bits = vMoveMask(candidates);
+    while(bits) {
+        int l = lowestBit(bits);
+        bits &= bits - 1;
+        if(simMaskHitsPipe(&batch->config, birdX, batch->birdY[i + l], batch->pipeX[p][i + l], batch->gapY[p][i + l])) {
+            lanes[l] = ~0u;
+        }
+    }
+    return vLoadMask(lanes);
+}
+
+void simBatchStep(SimBatch *batch, const uint8_t *jump, float dt, uint8_t *events) {
+    const SimConfig *c = &batch->config;
+
+    // same expressions as simStep/simCheckCollision so results match bit for bit
+    const float w = c->birdWidth*c->hitShrink;
+    const float h = c->birdHeight*c->hitShrink;
+    const float birdX = c->screenWidth/2.0f;
+
+    const vfloat gravityDt = vSet1(c->gravity*dt);
+    const vfloat pipeStep = vSet1(c->pipeSpeed*dt);
+    const vfloat vdt = vSet1(dt);
+    const vfloat jumpForce = vSet1(c->jumpForce);
+    const vfloat pipeWidth = vSet1(c->pipeWidth);
+    const vfloat screenWidth = vSet1(c->screenWidth);
+    const vfloat screenHeight = vSet1(c->screenHeight);
+    const vfloat halfGap = vSet1(c->gapSize/2);
+    const vfloat halfBird = vSet1(c->birdHeight/2);
+    // with masks the box is the bird's solid pixels, on whole pixels
+    const SimMask *mask = c->birdMask;
+    const bool pixels = mask && c->pipeMask;
+    const float boxX = pixels ? floorf(birdX - mask->width/2.0f) + mask->left : birdX - w/2;
+    const float boxW = pixels ? mask->right - mask->left : w;
+    const vfloat hitX = vSet1(boxX);
+    const vfloat hitRight = vSet1(boxX + boxW);
+    const vfloat hitH = vSet1(pixels ? mask->bottom - mask->top : h);
+    const vfloat maskHalf = vSet1(pixels ? mask->height/2.0f : 0.0f);
+    const vfloat maskTop = vSet1(pixels ? mask->top : 0.0f);
+    const vfloat vBirdX = vSet1(birdX);
+    const vfloat zero = vSet1(0.0f);
+
+    for(int i = 0; i < batch->capacity; i += VEC_WIDTH) {
+        vfloat alive = vLoadMask(batch->alive + i);
+        if(vMoveMask(alive) == 0) {
+            if(events) for(int l = 0; l < VEC_WIDTH && i + l < batch->count; ++l) events[i + l] = 0;
+            continue;
+        }
+
+        // vLoadMask is an aligned load
+        _Alignas(BATCH_ALIGN) uint32_t jumpLanes[VEC_WIDTH] = {0};
+        if(jump) {
+            for(int l = 0; l < VEC_WIDTH && i + l < batch->count; ++l) jumpLanes[l] = jump[i + l] ? ~0u : 0u;
+        }
+        vfloat jumped = vAnd(alive, vLoadMask(jumpLanes));
+
+        // for bird gavity
+        vfloat vel = vLoad(batch->birdVel + i);
+        vel = vSelect(jumped, jumpForce, vel);
+        vfloat newVel = vAdd(vel, gravityDt);
+        vel = vSelect(alive, newVel, vel);
+
+        vfloat y = vLoad(batch->birdY + i);
+        y = vSelect(alive, vAdd(y, vMul(vel, vdt)), y);
+
+        vStore(batch->birdVel + i, vel);
+        vStore(batch->birdY + i, y);
+
+        // collision of top and bottom of our screen
+        vfloat hit, hitY, hitBottom;
+        if(pixels) {
+            hitY = vAdd(vFloor(vSub(y, maskHalf)), maskTop);
+            hitBottom = vAdd(hitY, hitH);
+            hit = vOr(vGe(hitBottom, screenHeight), vLe(hitY, zero));
+        } else {
+            hit = vOr(vGe(vAdd(y, halfBird), screenHeight), vLe(vSub(y, halfBird), zero));
+            hitY = vSub(y, vSet1(h/2));
+            hitBottom = vAdd(hitY, hitH);
+        }
+        vfloat scoredNow = vSet1(0.0f);
+
+        for(int p = 0; p < MAX_PIPES; ++p) {
+            // for pipe
+            vfloat x = vLoad(batch->pipeX[p] + i);
+            x = vSelect(alive, vSub(x, pipeStep), x);
+
+            vfloat respawn = vAnd(alive, vLe(vAdd(x, pipeWidth), zero));
+            vfloat scored = vLoadMask(batch->scored[p] + i);
+            x = vSelect(respawn, screenWidth, x);
+            scored = vAndNot(respawn, scored);
+            vStore(batch->pipeX[p] + i, x);
+
+            // new gaps are rare, hash them per lane
+            int lanes = vMoveMask(respawn);
+            while(lanes) {
+                int l = lowestBit(lanes);
+                lanes &= lanes - 1;
+                batch->gapY[p][i + l] = simPipeGap(c, batch->seed[i + l], batch->pipesSpawned[i + l]++);
+            }
+
+            // Check collision within the pipe
+            vfloat gap = vLoad(batch->gapY[p] + i);
+            vfloat gapTop = vSub(gap, halfGap);
+            vfloat gapBottom = vAdd(gap, halfGap);
+            vfloat overlapX = vAnd(vLt(hitX, vAdd(x, pipeWidth)), vGt(hitRight, x));
+            vfloat top = vAnd(vLt(hitY, gapTop), vGt(hitBottom, zero));
+            vfloat bottom = vAnd(vLt(hitY, vAdd(gapBottom, vSub(screenHeight, gapBottom))), vGt(hitBottom, gapBottom));
+            vfloat pipeHit = vAnd(overlapX, vOr(top, bottom));
+            if(pixels) pipeHit = maskLanes(batch, i, p, vAnd(alive, pipeHit));
+            hit = vOr(hit, pipeHit);
+
+            // score logic
+            vfloat passed = vAnd(alive, vAndNot(scored, vGt(vBirdX, vAdd(x, pipeWidth))));
+            vIncrement(batch->score + i, passed);
+            scored = vOr(scored, passed);
+            scoredNow = vOr(scoredNow, passed);
+            vStoreMask(batch->scored[p] + i, scored);
+        }
+
+        vfloat died = vAnd(alive, hit);
+        vStoreMask(batch->alive + i, vAndNot(hit, alive));
+        vIncrement(batch->tick + i, alive);
+
+        if(events) {
+            int jumpBits = vMoveMask(jumped);
+            int scoreBits = vMoveMask(scoredNow);
+            int deathBits = vMoveMask(died);
+            for(int l = 0; l < VEC_WIDTH && i + l < batch->count; ++l) {
+                events[i + l] = (uint8_t)((((jumpBits >> l) & 1) ? SIM_EVENT_JUMP : 0) |
+                                          (((scoreBits >> l) & 1) ? SIM_EVENT_SCORE : 0) |
+                                          (((deathBits >> l) & 1) ? SIM_EVENT_DEATH : 0));
+            }
+        }
+    }
+}
+
+#else
+
+// portable fallback, one world at a time through the scalar rules
+void simBatchStep(SimBatch *batch, const uint8_t *jump, float dt, uint8_t *events) {
+    for(int i = 0; i < batch->count; ++i) {
+        SimWorld world;
+        simBatchGet(batch, i, &world);
+        int e = simStep(&world, (SimInput){jump ? jump[i] != 0 : false}, dt);
+        simBatchSet(batch, i, &world);
+        if(events) events[i] = (uint8_t)e;
+    }
+}
+
+#endif
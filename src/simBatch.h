@@ -0,0 +1,55 @@
+#ifndef SIM_BATCH_H
+#define SIM_BATCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sim.h"
+
+// Many independent worlds stepped together. State is stored as
+// structure-of-arrays so one SSE/AVX2 instruction advances 4/8 worlds.
+// Every world follows exactly the same rules (and float math) as simStep.
+// Only the endless pipes: config.course must be NULL. Each world keeps its
+// MAX_PIPES pipes in fixed slots, a respawn reuses the slot.
+
+// arrays are padded to this many worlds and aligned to its width in bytes
+#define SIM_BATCH_LANES 8
+
+typedef struct SimBatch {
+    SimConfig config;
+    int count;    // worlds in use
+    int capacity; // count rounded up to SIM_BATCH_LANES
+
+    float *birdY;
+    float *birdVel;
+
+    float *pipeX[MAX_PIPES]; // pipeX[pipe][world]
+    float *gapY[MAX_PIPES];
+    uint32_t *scored[MAX_PIPES]; // 0 or ~0
+
+    int32_t *score;
+    uint32_t *alive; // ~0 while the bird is alive, padding lanes are 0
+    uint32_t *tick;
+    uint64_t *seed;
+    uint32_t *pipesSpawned;
+
+    void *memory;
+} SimBatch;
+
+// Allocate count worlds, all reset with seed 0. Returns false on allocation
+// failure, or for a config with a course.
+bool simBatchInit(SimBatch *batch, const SimConfig *config, int count);
+void simBatchFree(SimBatch *batch);
+
+void simBatchReset(SimBatch *batch, int index, uint64_t seed);
+
+// Copy a single world in or out of the batch
+void simBatchSet(SimBatch *batch, int index, const SimWorld *world);
+void simBatchGet(const SimBatch *batch, int index, SimWorld *world);
+
+// Advance every live world by dt. jump[i] != 0 makes world i jump this
+// step (jump may be NULL). If events is not NULL it receives the
+// SIM_EVENT_* mask for every world.
+void simBatchStep(SimBatch *batch, const uint8_t *jump, float dt, uint8_t *events);
+
+#endif
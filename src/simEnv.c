@@ -0,0 +1,139 @@
+#include "simEnv.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rng.h"
+#include "simBatch.h"
+#include "simRender.h"
+
+struct SimEnv {
+    SimBatch batch;
+    uint32_t maxTicks;
+
+    uint64_t *seeds;    // from simEnvReset
+    uint32_t *episodes; // per world, counts resets since
+    int32_t *lastScore; // before the step, for the rewards
+
+    float *observations;
+    float *rewards;
+    uint8_t *terminals;
+    uint8_t *truncated;
+    float *finalObservations;
+};
+
+SimEnv *simEnvCreate(int count, uint32_t maxTicks) {
+    if(count <= 0) return NULL;
+    SimEnv *env = calloc(1, sizeof(*env));
+    if(env == NULL) return NULL;
+
+    SimConfig config = simDefaultConfig();
+    env->seeds = calloc(count, sizeof(uint64_t));
+    env->episodes = calloc(count, sizeof(uint32_t));
+    env->lastScore = calloc(count, sizeof(int32_t));
+    if(env->seeds == NULL || env->episodes == NULL || env->lastScore == NULL || !simBatchInit(&env->batch, &config, count)) {
+        simEnvFree(env);
+        return NULL;
+    }
+    env->maxTicks = maxTicks;
+    return env;
+}
+
+void simEnvFree(SimEnv *env) {
+    if(env == NULL) return;
+    simBatchFree(&env->batch);
+    free(env->seeds);
+    free(env->episodes);
+    free(env->lastScore);
+    free(env);
+}
+
+int simEnvCount(const SimEnv *env) {
+    return env->batch.count;
+}
+
+void simEnvBind(SimEnv *env, float *observations, float *rewards, uint8_t *terminals,
+                uint8_t *truncated, float *finalObservations) {
+    env->observations = observations;
+    env->rewards = rewards;
+    env->terminals = terminals;
+    env->truncated = truncated;
+    env->finalObservations = finalObservations;
+}
+
+// one row, see SIM_ENV_OBS
+static void observe(const SimBatch *b, int i, float *row) {
+    const SimConfig *c = &b->config;
+    const float birdX = c->screenWidth/2.0f;
+    const float left = birdX - c->birdWidth*c->hitShrink/2;
+    const float birdY = b->birdY[i];
+
+    // the two leftmost pipes the box hasn't cleared, slots aren't in order
+    int first = -1, second = -1;
+    for(int p = 0; p < MAX_PIPES; ++p) {
+        float x = b->pipeX[p][i];
+        if(x + c->pipeWidth < left) continue;
+        if(first < 0 || x < b->pipeX[first][i]) {
+            second = first;
+            first = p;
+        } else if(second < 0 || x < b->pipeX[second][i]) {
+            second = p;
+        }
+    }
+
+    row[0] = birdY/c->screenHeight;
+    row[1] = b->birdVel[i]/fabsf(c->jumpForce);
+    int next[2] = {first, second};
+    for(int k = 0; k < 2; ++k) {
+        // nothing ahead (never with the endless pipes): far away, level
+        float dx = c->screenWidth, dy = 0.0f;
+        if(next[k] >= 0) {
+            dx = b->pipeX[next[k]][i] + c->pipeWidth - birdX;
+            dy = b->gapY[next[k]][i] - birdY;
+        }
+        row[2 + 2*k] = dx/c->screenWidth;
+        row[3 + 2*k] = dy/c->screenHeight;
+    }
+}
+
+void simEnvReset(SimEnv *env, const uint64_t *seeds) {
+    SimBatch *b = &env->batch;
+    for(int i = 0; i < b->count; ++i) {
+        env->seeds[i] = seeds ? seeds[i] : (uint64_t)i;
+        env->episodes[i] = 0;
+        simBatchReset(b, i, rngAt(env->seeds[i], 0));
+        env->lastScore[i] = b->score[i];
+
+        observe(b, i, env->observations + (size_t)i*SIM_ENV_OBS);
+        env->rewards[i] = 0.0f;
+        env->terminals[i] = 0;
+        env->truncated[i] = 0;
+    }
+}
+
+void simEnvStep(SimEnv *env, const uint8_t *actions) {
+    SimBatch *b = &env->batch;
+    simBatchStep(b, actions, SIM_TICK_DT, NULL);
+
+    for(int i = 0; i < b->count; ++i) {
+        float *row = env->observations + (size_t)i*SIM_ENV_OBS;
+        bool dead = b->alive[i] == 0;
+        bool cut = !dead && env->maxTicks > 0 && b->tick[i] >= env->maxTicks;
+
+        env->rewards[i] = (b->score[i] - env->lastScore[i])*SIM_ENV_REWARD_PIPE + (dead ? SIM_ENV_REWARD_DEATH : 0.0f);
+        env->terminals[i] = dead;
+        env->truncated[i] = cut;
+
+        if(dead || cut) {
+            if(env->finalObservations) observe(b, i, env->finalObservations + (size_t)i*SIM_ENV_OBS);
+            simBatchReset(b, i, rngAt(env->seeds[i], ++env->episodes[i]));
+        }
+        observe(b, i, row);
+        env->lastScore[i] = b->score[i];
+    }
+}
+
+int simEnvRender(const SimEnv *env, uint8_t *frames, int width, int height, int flags) {
+    return simBatchRender(&env->batch, frames, width, height, flags);
+}
@@ -0,0 +1,64 @@
+#ifndef SIM_ENV_H
+#define SIM_ENV_H
+
+#include <stdint.h>
+
+// Vectorized training environments, gym style: N worlds stepped together
+// on a SimBatch behind a plain C ABI (built as the simEnv shared library,
+// for ctypes/cffi and the like). The caller owns every buffer: bind them
+// once and each step writes observations, rewards and flags straight into
+// them, nothing is allocated or copied per step.
+//
+// A world that dies or runs out of ticks is reset within the same step:
+// its terminal/truncated flag is set and its observation row is already
+// the new episode's first. The last row of the old episode goes to
+// finalObservations if one is bound. Episode k of world i uses seed
+// rngAt(seeds[i], k), so a run is reproducible from the reset seeds.
+//
+// Not thread safe, use one environment per thread.
+
+#if defined(_WIN32)
+#define SIM_ENV_API __declspec(dllexport)
+#else
+#define SIM_ENV_API __attribute__((visibility("default")))
+#endif
+
+// Floats per observation row:
+//   0 birdY/screenHeight
+//   1 birdVel/|jumpForce|
+//   2 next pipe: distance from the bird to its far edge/screenWidth
+//   3 next pipe: (gapY - birdY)/screenHeight
+//   4, 5 the same for the pipe after
+// "next" is the first pipe the bird's box hasn't cleared yet.
+#define SIM_ENV_OBS 6
+
+// Rewards: +1 per pipe passed, -1 on death, 0 otherwise
+#define SIM_ENV_REWARD_PIPE 1.0f
+#define SIM_ENV_REWARD_DEATH -1.0f
+
+typedef struct SimEnv SimEnv;
+
+// count worlds with the game's default rules. maxTicks > 0 truncates
+// episodes after that many steps. NULL on allocation failure.
+SIM_ENV_API SimEnv *simEnvCreate(int count, uint32_t maxTicks);
+SIM_ENV_API void simEnvFree(SimEnv *env);
+SIM_ENV_API int simEnvCount(const SimEnv *env);
+
+// observations: count*SIM_ENV_OBS floats, rewards: count floats,
+// terminals/truncated: count bytes set to 0/1. finalObservations is
+// optional (NULL), the rest are required.
+SIM_ENV_API void simEnvBind(SimEnv *env, float *observations, float *rewards, uint8_t *terminals,
+                            uint8_t *truncated, float *finalObservations);
+
+// Starts every world over, seeds[i] for world i (NULL: seed i), and
+// writes the first observations. Rewards and flags are cleared.
+SIM_ENV_API void simEnvReset(SimEnv *env, const uint64_t *seeds);
+
+// One tick (SIM_TICK_DT) for every world, actions[i] != 0 jumps
+SIM_ENV_API void simEnvStep(SimEnv *env, const uint8_t *actions);
+
+// Every world's current frame (simRender.h), count*width*height bytes.
+// flags are SIM_RENDER_*. 0 if the size is out of range.
+SIM_ENV_API int simEnvRender(const SimEnv *env, uint8_t *frames, int width, int height, int flags);
+
+#endif
@@ -0,0 +1,97 @@
+#include "sim.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+bool simMaskBuild(SimMask *mask, const uint8_t *rgba, int width, int height, uint8_t threshold) {
+    memset(mask, 0, sizeof(*mask));
+    if(width <= 0 || height <= 0) return false;
+
+    int stride = (width + 63)/64;
+    uint64_t *bits = calloc((size_t)stride*height, sizeof(uint64_t));
+    if(bits == NULL) return false;
+
+    int left = width, top = height, right = 0, bottom = 0;
+    for(int y = 0; y < height; ++y) {
+        const uint8_t *pixel = rgba + (size_t)y*width*4;
+        for(int x = 0; x < width; ++x) {
+            if(pixel[x*4 + 3] < threshold) continue;
+            bits[(size_t)y*stride + x/64] |= 1ull << (x & 63);
+            if(x < left) left = x;
+            if(x >= right) right = x + 1;
+            if(y < top) top = y;
+            bottom = y + 1;
+        }
+    }
+
+    mask->width = width;
+    mask->height = height;
+    mask->stride = stride;
+    mask->bits = bits;
+    // nothing solid, nothing to hit
+    if(right > 0) {
+        mask->left = left;
+        mask->top = top;
+        mask->right = right;
+        mask->bottom = bottom;
+    }
+    return true;
+}
+
+void simMaskFree(SimMask *mask) {
+    free(mask->bits);
+    memset(mask, 0, sizeof(*mask));
+}
+
+// 64 pixels of a row from pixel start on, clear outside the row
+static uint64_t rowBits(const uint64_t *row, int stride, int start) {
+    if(start <= -64 || start >= stride*64) return 0;
+    if(start < 0) return row[0] << -start;
+
+    int word = start >> 6, shift = start & 63;
+    uint64_t bits = row[word] >> shift;
+    if(shift && word + 1 < stride) bits |= row[word + 1] << (64 - shift);
+    return bits;
+}
+
+// One half of a pipe, the sprite stretched over screen rows top..bottom
+static bool hitsHalf(const SimMask *bird, const SimMask *pipe, int birdTop, int shift, float top, float bottom) {
+    // rows with their centre inside the half, and solid in the bird
+    int y0 = (int)ceilf(top - 0.5f), y1 = (int)ceilf(bottom - 0.5f);
+    if(y0 < birdTop + bird->top) y0 = birdTop + bird->top;
+    if(y1 > birdTop + bird->bottom) y1 = birdTop + bird->bottom;
+
+    float scale = pipe->height/(bottom - top);
+    int w0 = bird->left >> 6, w1 = (bird->right - 1) >> 6;
+    for(int y = y0; y < y1; ++y) {
+        int row = (int)((y + 0.5f - top)*scale);
+        if(row >= pipe->height) row = pipe->height - 1;
+
+        const uint64_t *b = bird->bits + (size_t)(y - birdTop)*bird->stride;
+        const uint64_t *p = pipe->bits + (size_t)row*pipe->stride;
+        for(int w = w0; w <= w1; ++w) {
+            if(b[w] & rowBits(p, pipe->stride, shift + w*64)) return true;
+        }
+    }
+    return false;
+}
+
+bool simMaskHitsPipe(const SimConfig *config, float birdX, float birdY, float pipeX, float gapY) {
+    const SimMask *bird = config->birdMask, *pipe = config->pipeMask;
+    if(bird->right <= bird->left || pipe->right <= pipe->left) return false;
+
+    // the bird sits on whole pixels like main.c draws it, a pipe column is
+    // the one under the pixel's centre
+    int birdLeft = (int)floorf(birdX - bird->width/2.0f);
+    int birdTop = (int)floorf(birdY - bird->height/2.0f);
+    int shift = (int)floorf(birdLeft + 0.5f - pipeX);
+
+    // the solid columns have to line up at all
+    if(shift + bird->right <= pipe->left || shift + bird->left >= pipe->right) return false;
+
+    float gapTop = gapY - config->gapSize/2;
+    float gapBottom = gapY + config->gapSize/2;
+    return hitsHalf(bird, pipe, birdTop, shift, 0, gapTop) ||
+           hitsHalf(bird, pipe, birdTop, shift, gapBottom, config->screenHeight);
+}
@@ -0,0 +1,181 @@
+#include "simRender.h"
+
+#include <math.h>
+#include <stddef.h>
+
+#include "rng.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RENDER_SSE2
+#endif
+
+#define LAYERS 3
+
+const uint8_t simRenderGray[SIM_PIXEL_COUNT] = {35, 60, 85, 110, 170, 255};
+
+// main.c's scroll speeds in px/s, then the skylines: block width and the
+// lowest/highest block as a part of the screen height
+static const float layerSpeed[LAYERS] = {20.0f, 100.0f, 200.0f};
+static const float layerBlock[LAYERS] = {160.0f, 96.0f, 64.0f};
+static const float layerLow[LAYERS] = {0.25f, 0.15f, 0.05f};
+static const float layerHigh[LAYERS] = {0.5f, 0.35f, 0.2f};
+
+// What a frame needs, from a world or a batch lane
+typedef struct View {
+    float birdX, birdY;
+    float time; // seconds played, the parallax scrolls with it
+    int pipeCount;
+    float pipeX[SIM_PIPE_RING];
+    float gapY[SIM_PIPE_RING];
+} View;
+
+// First column/row whose centre is at or past screen coordinate x
+static int pixelAt(float x, float scale, int limit) {
+    float i = ceilf(x*scale - 0.5f);
+    return i < 0 ? 0 : i > limit ? limit : (int)i;
+}
+
+static void fillSpan(uint8_t *p, int count, uint8_t value) {
+#ifdef RENDER_SSE2
+    if(count >= 16) {
+        __m128i v = _mm_set1_epi8((char)value);
+        for(; count > 16; count -= 16, p += 16) _mm_storeu_si128((__m128i *)p, v);
+        // the last 16 overlap what's done instead of a byte loop
+        _mm_storeu_si128((__m128i *)(p + count - 16), v);
+        return;
+    }
+#endif
+    for(; count > 0; --count) *p++ = value;
+}
+
+// The layers over the sky, a layer covers the rows from its top on
+static void backgroundRow(uint8_t *row, int width, int y, int16_t tops[LAYERS][SIM_RENDER_MAX_SIZE], const uint8_t *colors) {
+    int c = 0;
+#ifdef RENDER_SSE2
+    const __m128i vy = _mm_set1_epi16((short)y);
+    for(; width >= 16 && c < width; c += 16) {
+        // the last 16 overlap what's done, same pixels again
+        if(c > width - 16) c = width - 16;
+        __m128i out = _mm_set1_epi8((char)colors[SIM_PIXEL_SKY]);
+        for(int l = 0; l < LAYERS; ++l) {
+            // where the top is below this row the layer isn't there
+            __m128i lo = _mm_cmpgt_epi16(_mm_loadu_si128((const __m128i *)(tops[l] + c)), vy);
+            __m128i hi = _mm_cmpgt_epi16(_mm_loadu_si128((const __m128i *)(tops[l] + c + 8)), vy);
+            __m128i keep = _mm_packs_epi16(lo, hi);
+            __m128i color = _mm_set1_epi8((char)colors[SIM_PIXEL_BACK + l]);
+            out = _mm_or_si128(_mm_and_si128(keep, out), _mm_andnot_si128(keep, color));
+        }
+        _mm_storeu_si128((__m128i *)(row + c), out);
+    }
+#endif
+    for(; c < width; ++c) {
+        uint8_t out = colors[SIM_PIXEL_SKY];
+        for(int l = 0; l < LAYERS; ++l) {
+            if(tops[l][c] <= y) out = colors[SIM_PIXEL_BACK + l];
+        }
+        row[c] = out;
+    }
+}
+
+static void render(const SimConfig *config, const View *view, uint8_t *pixels, int width, int height, int flags) {
+    uint8_t colors[SIM_PIXEL_COUNT];
+    for(int i = 0; i < SIM_PIXEL_COUNT; ++i) colors[i] = flags & SIM_RENDER_PALETTE ? (uint8_t)i : simRenderGray[i];
+
+    const float sx = width/config->screenWidth;
+    const float sy = height/config->screenHeight;
+
+    // skyline tops per column
+    int16_t tops[LAYERS][SIM_RENDER_MAX_SIZE];
+    bool parallax = flags & SIM_RENDER_PARALLAX;
+    for(int l = 0; parallax && l < LAYERS; ++l) {
+        float scroll = view->time*layerSpeed[l];
+        uint64_t last = UINT64_MAX;
+        int16_t top = 0;
+        for(int c = 0; c < width; ++c) {
+            // a block spans many columns, only look up each once
+            uint64_t block = (uint64_t)(((c + 0.5f)/sx + scroll)/layerBlock[l]);
+            if(block != last) {
+                float h = layerLow[l] + (layerHigh[l] - layerLow[l])*rngFloatAt(l + 1, block);
+                top = (int16_t)pixelAt(config->screenHeight*(1 - h), sy, height);
+                last = block;
+            }
+            tops[l][c] = top;
+        }
+    }
+
+    // the pipes' columns, and the rows of their gaps
+    int pipes = 0;
+    int left[SIM_PIPE_RING], right[SIM_PIPE_RING], gapTop[SIM_PIPE_RING], gapBottom[SIM_PIPE_RING];
+    for(int p = 0; p < view->pipeCount; ++p) {
+        left[pipes] = pixelAt(view->pipeX[p], sx, width);
+        right[pipes] = pixelAt(view->pipeX[p] + config->pipeWidth, sx, width);
+        if(left[pipes] >= right[pipes]) continue;
+        gapTop[pipes] = pixelAt(view->gapY[p] - config->gapSize/2, sy, height);
+        gapBottom[pipes] = pixelAt(view->gapY[p] + config->gapSize/2, sy, height);
+        ++pipes;
+    }
+
+    const float rx = config->birdWidth/2, ry = config->birdHeight/2;
+    const int birdTop = pixelAt(view->birdY - ry, sy, height);
+    const int birdBottom = pixelAt(view->birdY + ry, sy, height);
+
+    for(int y = 0; y < height; ++y) {
+        uint8_t *row = pixels + (size_t)y*width;
+        if(parallax) backgroundRow(row, width, y, tops, colors);
+        else fillSpan(row, width, colors[SIM_PIXEL_SKY]);
+
+        for(int p = 0; p < pipes; ++p) {
+            if(y < gapTop[p] || y >= gapBottom[p]) fillSpan(row + left[p], right[p] - left[p], colors[SIM_PIXEL_PIPE]);
+        }
+
+        if(y >= birdTop && y < birdBottom) {
+            float dy = ((y + 0.5f)/sy - view->birdY)/ry;
+            float half = rx*sqrtf(fmaxf(1 - dy*dy, 0.0f));
+            int c0 = pixelAt(view->birdX - half, sx, width);
+            int c1 = pixelAt(view->birdX + half, sx, width);
+            if(c1 > c0) fillSpan(row + c0, c1 - c0, colors[SIM_PIXEL_BIRD]);
+        }
+    }
+}
+
+static bool sizeOk(int width, int height) {
+    return width > 0 && height > 0 && width <= SIM_RENDER_MAX_SIZE && height <= SIM_RENDER_MAX_SIZE;
+}
+
+bool simRender(const SimWorld *world, uint8_t *pixels, int width, int height, int flags) {
+    if(!sizeOk(width, height)) return false;
+
+    View view;
+    view.birdX = world->birdX;
+    view.birdY = world->birdY;
+    view.time = world->tick*SIM_TICK_DT;
+    view.pipeCount = (int)world->pipeCount;
+    for(uint32_t k = 0; k < world->pipeCount; ++k) {
+        uint32_t i = simPipeSlot(world, k);
+        view.pipeX[k] = world->pipeX[i];
+        view.gapY[k] = world->gapY[i];
+    }
+    render(&world->config, &view, pixels, width, height, flags);
+    return true;
+}
+
+bool simBatchRender(const SimBatch *batch, uint8_t *frames, int width, int height, int flags) {
+    if(!sizeOk(width, height)) return false;
+
+    View view;
+    view.birdX = batch->config.screenWidth/2.0f;
+    view.pipeCount = MAX_PIPES;
+    size_t frameSize = (size_t)width*height;
+    for(int i = 0; i < batch->count; ++i) {
+        view.birdY = batch->birdY[i];
+        view.time = batch->tick[i]*SIM_TICK_DT;
+        // slot order doesn't matter here
+        for(int p = 0; p < MAX_PIPES; ++p) {
+            view.pipeX[p] = batch->pipeX[p][i];
+            view.gapY[p] = batch->gapY[p][i];
+        }
+        render(&batch->config, &view, frames + i*frameSize, width, height, flags);
+    }
+    return true;
+}
@@ -0,0 +1,44 @@
+#ifndef SIM_RENDER_H
+#define SIM_RENDER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "sim.h"
+#include "simBatch.h"
+
+// Small frames straight from world state on the CPU, for agents that
+// learn from pixels on machines without a GPU. One byte per pixel, rows
+// top to bottom, each pixel sampled at its centre (no filtering):
+// background, pipes, then the bird as an ellipse of birdWidth x
+// birdHeight. With SIM_RENDER_PARALLAX the three background layers are
+// stand-in skylines scrolling at main.c's speeds, not the textures.
+//
+// Rows are filled as spans, 16 pixels per SSE2 store where there is SSE2.
+
+#define SIM_RENDER_MAX_SIZE 1024 // width and height
+
+// the bytes are palette indices instead of gray levels
+#define SIM_RENDER_PALETTE  (1 << 0)
+#define SIM_RENDER_PARALLAX (1 << 1)
+
+// Palette indices, back to front
+enum {
+    SIM_PIXEL_SKY,
+    SIM_PIXEL_BACK,
+    SIM_PIXEL_MID,
+    SIM_PIXEL_FRONT,
+    SIM_PIXEL_PIPE,
+    SIM_PIXEL_BIRD,
+    SIM_PIXEL_COUNT
+};
+
+// The gray level of each palette index
+extern const uint8_t simRenderGray[SIM_PIXEL_COUNT];
+
+// width*height bytes into pixels. false if the size is out of range.
+bool simRender(const SimWorld *world, uint8_t *pixels, int width, int height, int flags);
+// One frame per world, frames holds count*width*height bytes
+bool simBatchRender(const SimBatch *batch, uint8_t *frames, int width, int height, int flags);
+
+#endif
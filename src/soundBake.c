@@ -0,0 +1,110 @@
+// Build-time sound bank converter.
+//
+//   soundBake <out.bank> <sound.wav>...
+//
+// Resamples every sound once to the mixer rate (48 kHz stereo) and
+// stores it as IMA-ADPCM. The mixer keeps the bank in memory as is and
+// decodes a block at a time while mixing. Layout, little endian:
+//
+//   header  "FBNK", version, sound count, sample rate, block frames
+//   index   per sound: name[32] (file name without extension), frames,
+//           byte offset of its first block, byte size
+//   blocks  adpcm.h blocks, each sound starting on a block boundary
+
+#include <raylib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adpcm.h"
+#include "mixer.h"
+
+#define HEADER_SIZE MIXER_BANK_HEADER_SIZE
+#define ENTRY_SIZE MIXER_BANK_ENTRY_SIZE
+
+static void put32(uint8_t *p, uint32_t v) {
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+int main(int argc, char **argv) {
+    if(argc < 3) {
+        fprintf(stderr, "usage: %s <out.bank> <sound.wav>...\n", argv[0]);
+        return 1;
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+
+    uint32_t count = argc - 2;
+    uint8_t *index = calloc(count, ENTRY_SIZE);
+    uint8_t **data = calloc(count, sizeof(uint8_t *));
+    uint32_t *sizes = calloc(count, sizeof(uint32_t));
+    if(index == NULL || data == NULL || sizes == NULL) return 1;
+
+    uint32_t offset = HEADER_SIZE + count*ENTRY_SIZE;
+    size_t pcmBytes = 0;
+    for(uint32_t i = 0; i < count; ++i) {
+        const char *path = argv[2 + i];
+        Wave wave = LoadWave(path);
+        if(wave.data == NULL || wave.frameCount == 0) {
+            fprintf(stderr, "can't load %s\n", path);
+            return 1;
+        }
+        WaveFormat(&wave, MIXER_SAMPLE_RATE, 16, ADPCM_CHANNELS);
+
+        uint32_t blocks = adpcmBlockCount(wave.frameCount);
+        sizes[i] = blocks*ADPCM_BLOCK_BYTES;
+        data[i] = malloc(sizes[i]);
+        if(data[i] == NULL) return 1;
+
+        // start the predictor on the first frame so there is no ramp up from 0
+        const int16_t *pcm = wave.data;
+        AdpcmState state[ADPCM_CHANNELS] = {{pcm[0], 0}, {pcm[1], 0}};
+        for(uint32_t b = 0; b < blocks; ++b) {
+            uint32_t first = b*ADPCM_BLOCK_FRAMES;
+            uint32_t frames = wave.frameCount - first;
+            if(frames > ADPCM_BLOCK_FRAMES) frames = ADPCM_BLOCK_FRAMES;
+            adpcmEncodeBlock(data[i] + b*ADPCM_BLOCK_BYTES, pcm + first*ADPCM_CHANNELS, frames, state);
+        }
+
+        uint8_t *entry = index + i*ENTRY_SIZE;
+        snprintf((char *)entry, 32, "%s", GetFileNameWithoutExt(path));
+        put32(entry + 32, wave.frameCount);
+        put32(entry + 36, offset);
+        put32(entry + 40, sizes[i]);
+        offset += sizes[i];
+
+        pcmBytes += (size_t)wave.frameCount*ADPCM_CHANNELS*sizeof(int16_t);
+        UnloadWave(wave);
+    }
+
+    uint8_t header[HEADER_SIZE];
+    memcpy(header, "FBNK", 4);
+    put32(header + 4, MIXER_BANK_VERSION);
+    put32(header + 8, count);
+    put32(header + 12, MIXER_SAMPLE_RATE);
+    put32(header + 16, ADPCM_BLOCK_FRAMES);
+
+    FILE *out = fopen(argv[1], "wb");
+    if(out == NULL) {
+        fprintf(stderr, "can't write %s\n", argv[1]);
+        return 1;
+    }
+    bool ok = fwrite(header, HEADER_SIZE, 1, out) == 1;
+    ok = ok && fwrite(index, ENTRY_SIZE, count, out) == count;
+    for(uint32_t i = 0; i < count; ++i) {
+        ok = ok && fwrite(data[i], 1, sizes[i], out) == sizes[i];
+        free(data[i]);
+    }
+    ok = fclose(out) == 0 && ok;
+    free(index);
+    free(data);
+    free(sizes);
+
+    if(!ok) {
+        fprintf(stderr, "can't write %s\n", argv[1]);
+        return 1;
+    }
+    printf("%s: %u sounds, %u bytes (%.1fx smaller than 16-bit PCM)\n", argv[1], count, offset, (double)pcmBytes/offset);
+    return 0;
+}
@@ -0,0 +1,82 @@
+#include "spriteBatch.h"
+
+#include <rlgl.h>
+#include <stdlib.h>
+
+void spriteBatchFree(SpriteBatch *batch) {
+    free(batch->quads);
+    batch->quads = NULL;
+    batch->count = batch->capacity = 0;
+}
+
+void spriteBatchBegin(SpriteBatch *batch) {
+    batch->count = 0;
+}
+
+void spriteBatchDraw(SpriteBatch *batch, int layer, Sprite sprite, Rectangle dest, Color tint) {
+    if(sprite.texture.id == 0) return;
+
+    if(batch->count == batch->capacity) {
+        int grown = batch->capacity ? batch->capacity*2 : 64;
+        SpriteQuad *quads = realloc(batch->quads, grown*sizeof(SpriteQuad));
+        if(quads == NULL) return;
+        batch->quads = quads;
+        batch->capacity = grown;
+    }
+
+    float w = sprite.texture.width, h = sprite.texture.height;
+    SpriteQuad *q = &batch->quads[batch->count];
+    q->key = (uint64_t)(layer & 0xff) << 56 | (uint64_t)(sprite.texture.id & 0xffffff) << 32 | (uint32_t)batch->count;
+    q->u0 = sprite.source.x/w;
+    q->v0 = sprite.source.y/h;
+    q->u1 = (sprite.source.x + sprite.source.width)/w;
+    q->v1 = (sprite.source.y + sprite.source.height)/h;
+    q->dest = spriteTrimmedDest(sprite, dest);
+    q->tint = tint;
+    ++batch->count;
+}
+
+static int compareQuads(const void *a, const void *b) {
+    uint64_t x = ((const SpriteQuad *)a)->key, y = ((const SpriteQuad *)b)->key;
+    return (x > y) - (x < y);
+}
+
+static unsigned int quadTexture(const SpriteQuad *q) {
+    return (unsigned int)(q->key >> 32) & 0xffffff;
+}
+
+void spriteBatchEnd(SpriteBatch *batch) {
+    batch->textureSwitches = 0;
+    if(batch->count == 0) return;
+
+    qsort(batch->quads, batch->count, sizeof(SpriteQuad), compareQuads);
+
+    BeginBlendMode(SPRITE_BLEND_MODE);
+    unsigned int bound = 0;
+    for(int i = 0; i < batch->count; ++i) {
+        const SpriteQuad *q = &batch->quads[i];
+        unsigned int texture = quadTexture(q);
+        if(texture != bound) {
+            if(bound) rlEnd();
+            rlSetTexture(texture);
+            rlBegin(RL_QUADS);
+            rlNormal3f(0.0f, 0.0f, 1.0f);
+            bound = texture;
+            ++batch->textureSwitches;
+        }
+
+        // flushes and reopens the quad list if rlgl's vertex buffer is full
+        rlCheckRenderBatchLimit(4);
+
+        float x0 = q->dest.x, y0 = q->dest.y;
+        float x1 = x0 + q->dest.width, y1 = y0 + q->dest.height;
+        rlColor4ub(q->tint.r, q->tint.g, q->tint.b, q->tint.a);
+        rlTexCoord2f(q->u0, q->v0); rlVertex2f(x0, y0);
+        rlTexCoord2f(q->u0, q->v1); rlVertex2f(x0, y1);
+        rlTexCoord2f(q->u1, q->v1); rlVertex2f(x1, y1);
+        rlTexCoord2f(q->u1, q->v0); rlVertex2f(x1, y0);
+    }
+    rlEnd();
+    rlSetTexture(0);
+    EndBlendMode();
+}
@@ -0,0 +1,39 @@
+#ifndef SPRITE_BATCH_H
+#define SPRITE_BATCH_H
+
+#include <raylib.h>
+#include <stdint.h>
+
+#include "atlas.h"
+
+// Collects the sprite quads of a frame and submits them sorted by layer,
+// then texture. rlgl only starts a new draw call when the texture
+// changes, so every run of quads sharing a texture inside a layer (or
+// across neighbouring layers) goes out as one call. Quads in the same
+// layer and texture keep the order they were added in.
+
+typedef struct SpriteQuad {
+    uint64_t key; // layer, texture id, submission order
+    float u0, v0, u1, v1;
+    Rectangle dest;
+    Color tint;
+} SpriteQuad;
+
+typedef struct SpriteBatch {
+    SpriteQuad *quads;
+    int count;
+    int capacity;
+
+    // of the last spriteBatchEnd
+    int textureSwitches;
+} SpriteBatch;
+
+void spriteBatchFree(SpriteBatch *batch);
+
+void spriteBatchBegin(SpriteBatch *batch);
+// layer 0..255, lower layers are drawn first. dest is the untrimmed frame.
+void spriteBatchDraw(SpriteBatch *batch, int layer, Sprite sprite, Rectangle dest, Color tint);
+// Sorts and submits everything since spriteBatchBegin, in SPRITE_BLEND_MODE
+void spriteBatchEnd(SpriteBatch *batch);
+
+#endif
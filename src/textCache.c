@@ -0,0 +1,107 @@
+#include "textCache.h"
+
+#include <rlgl.h>
+#include <stdio.h>
+#include <string.h>
+
+// Same rules as raylib's DrawTextEx/MeasureTextEx, done once
+static void layout(CachedText *text) {
+    const Font *font = &text->font;
+    float scale = text->fontSize/font->baseSize;
+    float x = 0.0f, measured = 0.0f;
+    int length = 0;
+
+    text->glyphCount = 0;
+    for(const char *p = text->string; *p; ) {
+        int bytes = 0;
+        int codepoint = GetCodepointNext(p, &bytes);
+        int index = GetGlyphIndex(*font, codepoint);
+        p += bytes;
+        ++length;
+
+        const GlyphInfo *glyph = &font->glyphs[index];
+        Rectangle rec = font->recs[index];
+        if(codepoint != ' ' && codepoint != '\t') {
+            float pad = font->glyphPadding;
+            TextGlyph *g = &text->glyphs[text->glyphCount++];
+            g->source = (Rectangle){rec.x - pad, rec.y - pad, rec.width + 2*pad, rec.height + 2*pad};
+            g->dest = (Rectangle){
+                x + (glyph->offsetX - pad)*scale,
+                (glyph->offsetY - pad)*scale,
+                (rec.width + 2*pad)*scale,
+                (rec.height + 2*pad)*scale
+            };
+        }
+
+        x += (glyph->advanceX ? glyph->advanceX : rec.width)*scale + text->spacing;
+        measured += glyph->advanceX ? glyph->advanceX : rec.width + glyph->offsetX;
+    }
+
+    text->size.x = length ? measured*scale + (length - 1)*text->spacing : 0.0f;
+    text->size.y = text->fontSize;
+    text->laidOut = true;
+}
+
+void textCacheInitEx(CachedText *text, Font font, float fontSize, float spacing, const char *string) {
+    memset(text, 0, sizeof(*text));
+    text->font = font;
+    text->fontSize = fontSize;
+    text->spacing = spacing;
+    textCacheSet(text, string);
+}
+
+void textCacheInit(CachedText *text, float fontSize, const char *string) {
+    // what DrawText does with the default font
+    if(fontSize < 10.0f) fontSize = 10.0f;
+    textCacheInitEx(text, GetFontDefault(), fontSize, fontSize/10.0f, string);
+}
+
+void textCacheSet(CachedText *text, const char *string) {
+    if(text->laidOut && !text->isNumber && strcmp(text->string, string) == 0) return;
+
+    // longer strings are cut, the glyph array is fixed size
+    snprintf(text->string, sizeof(text->string), "%s", string);
+    text->isNumber = false;
+    layout(text);
+}
+
+void textCacheSetNumber(CachedText *text, int number) {
+    if(text->laidOut && text->isNumber && text->number == number) return;
+
+    snprintf(text->string, sizeof(text->string), "%d", number);
+    text->number = number;
+    text->isNumber = true;
+    layout(text);
+}
+
+void textCacheDraw(const CachedText *text, Vector2 position, Color tint) {
+    if(text->glyphCount == 0) return;
+
+    Texture2D texture = text->font.texture;
+    float w = texture.width, h = texture.height;
+
+    rlSetTexture(texture.id);
+    rlBegin(RL_QUADS);
+    rlNormal3f(0.0f, 0.0f, 1.0f);
+    rlColor4ub(tint.r, tint.g, tint.b, tint.a);
+    for(int i = 0; i < text->glyphCount; ++i) {
+        const TextGlyph *g = &text->glyphs[i];
+        rlCheckRenderBatchLimit(4);
+
+        float u0 = g->source.x/w, v0 = g->source.y/h;
+        float u1 = (g->source.x + g->source.width)/w, v1 = (g->source.y + g->source.height)/h;
+        float x0 = position.x + g->dest.x, y0 = position.y + g->dest.y;
+        float x1 = x0 + g->dest.width, y1 = y0 + g->dest.height;
+        rlTexCoord2f(u0, v0); rlVertex2f(x0, y0);
+        rlTexCoord2f(u0, v1); rlVertex2f(x0, y1);
+        rlTexCoord2f(u1, v1); rlVertex2f(x1, y1);
+        rlTexCoord2f(u1, v0); rlVertex2f(x1, y0);
+    }
+    rlEnd();
+    rlSetTexture(0);
+}
+
+void textCacheDrawCentered(const CachedText *text, float x, float y, Color tint) {
+    // MeasureText centering in the game rounds to whole pixels
+    textCacheDraw(text, (Vector2){(float)(int)(x - (int)text->size.x/2), y}, tint);
+}
@@ -0,0 +1,46 @@
+#ifndef TEXT_CACHE_H
+#define TEXT_CACHE_H
+
+#include <raylib.h>
+#include <stdbool.h>
+
+// A string laid out once into glyph quads. Drawing it is one texture bind
+// and a quad per glyph: no formatting, measuring or glyph lookups per
+// frame. Set it again only when the string changes; setting the same
+// string or number is a compare and nothing else. Layout and size match
+// DrawText/MeasureText (or DrawTextEx/MeasureTextEx for other fonts).
+
+#define TEXT_CACHE_MAX_GLYPHS 64
+
+typedef struct TextGlyph {
+    Rectangle source; // in the font texture
+    Rectangle dest; // relative to the top left of the text
+} TextGlyph;
+
+typedef struct CachedText {
+    Font font;
+    float fontSize;
+    float spacing;
+
+    char string[TEXT_CACHE_MAX_GLYPHS + 1];
+    int number;
+    bool isNumber;
+    bool laidOut;
+
+    TextGlyph glyphs[TEXT_CACHE_MAX_GLYPHS];
+    int glyphCount;
+    Vector2 size;
+} CachedText;
+
+// Default font with DrawText's spacing for fontSize
+void textCacheInit(CachedText *text, float fontSize, const char *string);
+void textCacheInitEx(CachedText *text, Font font, float fontSize, float spacing, const char *string);
+
+void textCacheSet(CachedText *text, const char *string);
+void textCacheSetNumber(CachedText *text, int number);
+
+void textCacheDraw(const CachedText *text, Vector2 position, Color tint);
+// Draws it centered on x
+void textCacheDrawCentered(const CachedText *text, float x, float y, Color tint);
+
+#endif
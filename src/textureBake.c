@@ -0,0 +1,246 @@
+// Build-time texture baker.
+//
+//   textureBake <in.png> <out.png|out.dds> [--width W] [--height H] [--premultiply] [--mips]
+//
+// Resamples a texture to the size it's drawn at (--width and/or --height,
+// the other side keeps the aspect ratio) and optionally premultiplies
+// alpha. A .png output stays RGBA8. A .dds output is BC3/DXT5, 4:1 over
+// RGBA8, with --mips adding the mip chain; its size is rounded to
+// multiples of 4 so every level is whole blocks.
+
+#include <raylib.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* BC3 */
+
+typedef struct Rgb {
+    int r, g, b;
+} Rgb;
+
+static uint16_t pack565(Rgb c) {
+    return (uint16_t)((c.r*31 + 127)/255 << 11 | (c.g*63 + 127)/255 << 5 | (c.b*31 + 127)/255);
+}
+
+static Rgb unpack565(uint16_t v) {
+    int r = v >> 11 & 31, g = v >> 5 & 63, b = v & 31;
+    return (Rgb){r << 3 | r >> 2, g << 2 | g >> 4, b << 3 | b >> 2};
+}
+
+static int distance(Rgb a, Rgb b) {
+    return (a.r - b.r)*(a.r - b.r) + (a.g - b.g)*(a.g - b.g) + (a.b - b.b)*(a.b - b.b);
+}
+
+// 8 bytes of alpha: two endpoints, 3-bit indices into the 8-value ramp
+static void compressAlpha(uint8_t *out, const Color px[16]) {
+    int lo = 255, hi = 0;
+    for(int i = 0; i < 16; ++i) {
+        if(px[i].a < lo) lo = px[i].a;
+        if(px[i].a > hi) hi = px[i].a;
+    }
+    out[0] = (uint8_t)hi;
+    out[1] = (uint8_t)lo;
+
+    int ramp[8] = {hi, lo};
+    for(int i = 1; i < 7; ++i) ramp[i + 1] = ((7 - i)*hi + i*lo)/7;
+
+    uint64_t bits = 0;
+    for(int i = 0; i < 16 && hi > lo; ++i) {
+        int best = 0, bestError = 256;
+        for(int j = 0; j < 8; ++j) {
+            int e = abs(ramp[j] - px[i].a);
+            if(e < bestError) {
+                best = j;
+                bestError = e;
+            }
+        }
+        bits |= (uint64_t)best << (3*i);
+    }
+    for(int i = 0; i < 6; ++i) out[2 + i] = (uint8_t)(bits >> (8*i));
+}
+
+// 8 bytes of colour: bounding box endpoints, inset a little, 2-bit indices
+static void compressColor(uint8_t *out, const Color px[16]) {
+    Rgb lo = {255, 255, 255}, hi = {0, 0, 0};
+    for(int i = 0; i < 16; ++i) {
+        if(px[i].r < lo.r) lo.r = px[i].r;
+        if(px[i].g < lo.g) lo.g = px[i].g;
+        if(px[i].b < lo.b) lo.b = px[i].b;
+        if(px[i].r > hi.r) hi.r = px[i].r;
+        if(px[i].g > hi.g) hi.g = px[i].g;
+        if(px[i].b > hi.b) hi.b = px[i].b;
+    }
+    Rgb inset = {(hi.r - lo.r)/16, (hi.g - lo.g)/16, (hi.b - lo.b)/16};
+    hi = (Rgb){hi.r - inset.r, hi.g - inset.g, hi.b - inset.b};
+    lo = (Rgb){lo.r + inset.r, lo.g + inset.g, lo.b + inset.b};
+
+    uint16_t c0 = pack565(hi), c1 = pack565(lo);
+    if(c0 < c1) {
+        uint16_t t = c0;
+        c0 = c1;
+        c1 = t;
+    }
+    out[0] = (uint8_t)c0; out[1] = (uint8_t)(c0 >> 8);
+    out[2] = (uint8_t)c1; out[3] = (uint8_t)(c1 >> 8);
+
+    // c0 > c1 selects the 4-colour mode, equal endpoints mean a flat block
+    Rgb a = unpack565(c0), b = unpack565(c1);
+    Rgb palette[4] = {
+        a, b,
+        {(2*a.r + b.r)/3, (2*a.g + b.g)/3, (2*a.b + b.b)/3},
+        {(a.r + 2*b.r)/3, (a.g + 2*b.g)/3, (a.b + 2*b.b)/3}
+    };
+
+    uint32_t bits = 0;
+    for(int i = 0; i < 16 && c0 != c1; ++i) {
+        Rgb p = {px[i].r, px[i].g, px[i].b};
+        int best = 0, bestError = distance(p, palette[0]);
+        for(int j = 1; j < 4; ++j) {
+            int e = distance(p, palette[j]);
+            if(e < bestError) {
+                best = j;
+                bestError = e;
+            }
+        }
+        bits |= (uint32_t)best << (2*i);
+    }
+    for(int i = 0; i < 4; ++i) out[4 + i] = (uint8_t)(bits >> (8*i));
+}
+
+// RGBA8 image, width and height multiples of 4
+static void compressBc3(uint8_t *out, const Color *pixels, int width, int height) {
+    for(int by = 0; by < height; by += 4) {
+        for(int bx = 0; bx < width; bx += 4) {
+            Color block[16];
+            for(int y = 0; y < 4; ++y) {
+                for(int x = 0; x < 4; ++x) block[y*4 + x] = pixels[(by + y)*width + bx + x];
+            }
+            compressAlpha(out, block);
+            compressColor(out + 8, block);
+            out += 16;
+        }
+    }
+}
+
+/* DDS */
+
+static void put32(uint8_t *p, uint32_t v) {
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+// image is straight alpha, every level is filtered that way and then
+// premultiplied if asked
+static bool writeDds(const char *path, Image image, bool mips, bool premultiply) {
+    int levels = 1;
+    if(mips) {
+        // only levels that are whole blocks
+        for(int w = image.width/2, h = image.height/2; w >= 4 && h >= 4 && w % 4 == 0 && h % 4 == 0; w /= 2, h /= 2) ++levels;
+    }
+
+    uint32_t topSize = (uint32_t)image.width*image.height; // 1 byte per pixel
+    uint8_t header[128] = {0};
+    memcpy(header, "DDS ", 4);
+    put32(header + 4, 124);
+    put32(header + 8, 0x1 | 0x2 | 0x4 | 0x1000 | 0x80000 | (levels > 1 ? 0x20000 : 0));
+    put32(header + 12, image.height);
+    put32(header + 16, image.width);
+    put32(header + 20, topSize);
+    put32(header + 28, levels);
+    put32(header + 76, 32); // pixel format
+    put32(header + 80, 0x4); // fourcc
+    memcpy(header + 84, "DXT5", 4);
+    put32(header + 108, 0x1000 | (levels > 1 ? 0x8 | 0x400000 : 0));
+
+    FILE *out = fopen(path, "wb");
+    if(out == NULL) return false;
+    bool ok = fwrite(header, sizeof(header), 1, out) == 1;
+
+    Image level = ImageCopy(image);
+    uint32_t written = 0;
+    for(int l = 0; l < levels && ok; ++l) {
+        if(l > 0) ImageResize(&level, level.width/2, level.height/2);
+        Image texels = ImageCopy(level);
+        if(premultiply) ImageAlphaPremultiply(&texels);
+        Color *pixels = LoadImageColors(texels);
+        UnloadImage(texels);
+        uint32_t size = (uint32_t)level.width*level.height;
+        uint8_t *blocks = malloc(size);
+        ok = pixels && blocks;
+        if(ok) {
+            compressBc3(blocks, pixels, level.width, level.height);
+            ok = fwrite(blocks, 1, size, out) == size;
+            written += size;
+        }
+        free(blocks);
+        UnloadImageColors(pixels);
+    }
+    UnloadImage(level);
+
+    // raylib reads twice the top level for a mip chain, pad up to that
+    for(; ok && levels > 1 && written < 2*topSize; ++written) ok = fputc(0, out) != EOF;
+
+    return fclose(out) == 0 && ok;
+}
+
+int main(int argc, char **argv) {
+    if(argc < 3) {
+        fprintf(stderr, "usage: %s <in.png> <out.png|out.dds> [--width W] [--height H] [--premultiply] [--mips]\n", argv[0]);
+        return 1;
+    }
+    const char *inPath = argv[1], *outPath = argv[2];
+    int width = 0, height = 0;
+    bool premultiply = false, mips = false;
+    for(int i = 3; i < argc; ++i) {
+        if(strcmp(argv[i], "--width") == 0 && i + 1 < argc) width = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--height") == 0 && i + 1 < argc) height = atoi(argv[++i]);
+        else if(strcmp(argv[i], "--premultiply") == 0) premultiply = true;
+        else if(strcmp(argv[i], "--mips") == 0) mips = true;
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+
+    SetTraceLogLevel(LOG_WARNING);
+
+    Image image = LoadImage(inPath);
+    if(image.data == NULL) {
+        fprintf(stderr, "can't load %s\n", inPath);
+        return 1;
+    }
+    ImageFormat(&image, PIXELFORMAT_UNCOMPRESSED_R8G8B8A8);
+    int inWidth = image.width, inHeight = image.height;
+
+    if(width == 0 && height == 0) {
+        width = image.width;
+        height = image.height;
+    } else if(width == 0) {
+        width = (int)((float)image.width*height/image.height + 0.5f);
+    } else if(height == 0) {
+        height = (int)((float)image.height*width/image.width + 0.5f);
+    }
+
+    bool dds = strcmp(GetFileExtension(outPath), ".dds") == 0;
+    if(dds) {
+        width = (width + 3)/4*4;
+        height = (height + 3)/4*4;
+    }
+    // raylib resizes RGBA8 as straight alpha, weighting colour by alpha so
+    // transparent texels don't bleed. Premultiplied input would come out
+    // with straight colour, so that's only done after filtering.
+    if(width != image.width || height != image.height) ImageResize(&image, width, height);
+    if(premultiply && !dds) ImageAlphaPremultiply(&image);
+
+    bool ok = dds ? writeDds(outPath, image, mips, premultiply) : ExportImage(image, outPath);
+    UnloadImage(image);
+    if(!ok) {
+        fprintf(stderr, "can't write %s\n", outPath);
+        return 1;
+    }
+
+    printf("%s: %dx%d -> %dx%d%s%s\n", GetFileName(outPath), inWidth, inHeight, width, height,
+           premultiply ? " premultiplied" : "", dds ? " BC3" : "");
+    return 0;
+}